@@ -0,0 +1,43 @@
+#pragma once
+#include <new>
+#include <cstddef>
+#include <limits>
+
+// std::allocator replacement handing out 'Alignment'-byte aligned blocks,
+// so vector storage starts on a cache line and suits aligned SIMD loads
+template<typename T, size_t Alignment = 64>
+class AlignedAllocator {
+public:
+    using value_type = T;
+
+    template<typename U>
+    struct rebind {
+        using other = AlignedAllocator<U, Alignment>;
+    };
+
+    AlignedAllocator() noexcept { }
+
+    template<typename U>
+    AlignedAllocator(const AlignedAllocator<U, Alignment>&) noexcept { }
+
+    T* allocate(const size_t count) {
+        if (count > std::numeric_limits<size_t>::max() / sizeof(T)) {
+            throw std::bad_array_new_length();
+        }
+        return static_cast<T*>(::operator new(count * sizeof(T), std::align_val_t(Alignment)));
+    }
+
+    void deallocate(T* pointer, size_t) noexcept {
+        ::operator delete(pointer, std::align_val_t(Alignment));
+    }
+
+    template<typename U>
+    bool operator==(const AlignedAllocator<U, Alignment>&) const noexcept {
+        return true;
+    }
+
+    template<typename U>
+    bool operator!=(const AlignedAllocator<U, Alignment>&) const noexcept {
+        return false;
+    }
+};
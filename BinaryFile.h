@@ -0,0 +1,189 @@
+#pragma once
+#include <string>
+#include <cstdio>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <type_traits>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+/* Versioned binary format of the files BinaryIO.h writes for SegmentTree2D
+   and Matrix2D.
+   A file is one fixed header followed by the flat element array, the array
+   starts at PAYLOAD_OFFSET so it is aligned in a mapping. The header keeps
+   the element size and a byte order marker, so a file written on another
+   platform is rejected instead of misread, and an FNV-1a checksum of the
+   payload.
+
+   BinaryFile::write(path, BinaryFile::MATRIX, columns, rows, data, count);
+   MappedFile file(path);
+   const BinaryFile::Header& header = BinaryFile::open<int>(file, BinaryFile::MATRIX);
+   const int* data = BinaryFile::payload<int>(file);
+ */
+namespace BinaryFile {
+    enum Kind : uint32_t {
+        SEGMENT_TREE_2D = 1,
+        MATRIX = 2
+    };
+
+    constexpr char MAGIC[8] = {'D', 'S', 'B', 'I', 'N', 'A', 'R', 'Y'};
+    constexpr uint32_t VERSION = 1;
+    constexpr uint32_t ENDIANNESS_MARKER = 0x01020304u;
+    constexpr size_t PAYLOAD_OFFSET = 64;
+
+    struct Header {
+        char magic[8];
+        uint32_t version;
+        uint32_t byteOrder;
+        uint32_t kind;
+        uint32_t elementSize;
+        uint64_t columns;
+        uint64_t rows;
+        uint64_t count;
+        uint64_t checksum;
+    };
+    static_assert(sizeof(Header) <= PAYLOAD_OFFSET, "header does not fit");
+
+    inline uint64_t checksum(const void* data, size_t size) {
+        const unsigned char* bytes = static_cast<const unsigned char*>(data);
+        uint64_t hash = 0xcbf29ce484222325ull;
+        for (size_t i = 0; i < size; ++i) {
+            hash = (hash ^ bytes[i]) * 0x100000001b3ull;
+        }
+        return hash;
+    }
+
+    template<typename T>
+    void write(const std::string& path, const Kind kind, const size_t columns,
+               const size_t rows, const T* data, const size_t count) {
+        static_assert(std::is_trivially_copyable<T>::value, "elements must be trivially copyable");
+        Header header = { };
+        std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+        header.version = VERSION;
+        header.byteOrder = ENDIANNESS_MARKER;
+        header.kind = kind;
+        header.elementSize = sizeof(T);
+        header.columns = columns;
+        header.rows = rows;
+        header.count = count;
+        header.checksum = checksum(data, count * sizeof(T));
+        unsigned char prefix[PAYLOAD_OFFSET] = { };
+        std::memcpy(prefix, &header, sizeof(header));
+        std::FILE* file = std::fopen(path.c_str(), "wb");
+        if (file == nullptr) {
+            throw std::runtime_error("cannot open " + path);
+        }
+        const bool written = std::fwrite(prefix, 1, PAYLOAD_OFFSET, file) == PAYLOAD_OFFSET &&
+                             (count == 0 || std::fwrite(data, sizeof(T), count, file) == count);
+        if (std::fclose(file) != 0 || !written) {
+            throw std::runtime_error("cannot write " + path);
+        }
+    }
+}
+
+// read-only mapping of a whole file, unmapped on destruction
+class MappedFile {
+public:
+    explicit MappedFile(const std::string& path) {
+        const int descriptor = ::open(path.c_str(), O_RDONLY);
+        if (descriptor < 0) {
+            throw std::runtime_error("cannot open " + path);
+        }
+        struct stat status;
+        if (::fstat(descriptor, &status) != 0) {
+            ::close(descriptor);
+            throw std::runtime_error("cannot read " + path);
+        }
+        length = static_cast<size_t>(status.st_size);
+        if (length > 0) {
+            void* mapping = ::mmap(nullptr, length, PROT_READ, MAP_SHARED, descriptor, 0);
+            if (mapping == MAP_FAILED) {
+                ::close(descriptor);
+                throw std::runtime_error("cannot map " + path);
+            }
+            address = static_cast<const unsigned char*>(mapping);
+        }
+        ::close(descriptor);
+    }
+
+    MappedFile(const MappedFile& other) = delete;
+    MappedFile(MappedFile&& other) : address(other.address), length(other.length) {
+        other.address = nullptr;
+        other.length = 0;
+    }
+
+    ~MappedFile() {
+        unmap();
+    }
+
+    const unsigned char* data() const {
+        return address;
+    }
+
+    size_t size() const {
+        return length;
+    }
+
+    MappedFile& operator=(const MappedFile& other) = delete;
+
+    MappedFile& operator=(MappedFile&& other) {
+        if (this != &other) {
+            unmap();
+            address = other.address;
+            length = other.length;
+            other.address = nullptr;
+            other.length = 0;
+        }
+        return *this;
+    }
+
+private:
+    const unsigned char* address = nullptr;
+    size_t length = 0;
+
+    void unmap() {
+        if (address != nullptr) {
+            ::munmap(const_cast<unsigned char*>(address), length);
+        }
+    }
+};
+
+namespace BinaryFile {
+    // checks the header and the payload of a mapped file, throws on any mismatch
+    template<typename T>
+    const Header& open(const MappedFile& file, const Kind kind, const bool verifyChecksum = true) {
+        static_assert(std::is_trivially_copyable<T>::value, "elements must be trivially copyable");
+        if (file.size() < PAYLOAD_OFFSET) {
+            throw std::runtime_error("file is too short");
+        }
+        const Header& header = *reinterpret_cast<const Header*>(file.data());
+        if (std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0) {
+            throw std::runtime_error("unknown file format");
+        }
+        if (header.version != VERSION) {
+            throw std::runtime_error("unsupported file version");
+        }
+        if (header.byteOrder != ENDIANNESS_MARKER) {
+            throw std::runtime_error("unsupported byte order");
+        }
+        if (header.kind != kind || header.elementSize != sizeof(T)) {
+            throw std::runtime_error("file holds another type");
+        }
+        if (header.count > (file.size() - PAYLOAD_OFFSET) / sizeof(T)) {
+            throw std::runtime_error("file is too short");
+        }
+        if (verifyChecksum &&
+            checksum(file.data() + PAYLOAD_OFFSET, header.count * sizeof(T)) != header.checksum) {
+            throw std::runtime_error("checksum mismatch");
+        }
+        return header;
+    }
+
+    template<typename T>
+    const T* payload(const MappedFile& file) {
+        return reinterpret_cast<const T*>(file.data() + PAYLOAD_OFFSET);
+    }
+}
@@ -0,0 +1,97 @@
+#pragma once
+#include <string>
+#include <algorithm>
+#include <stdexcept>
+#include <type_traits>
+#include "BinaryFile.h"
+#include "Matrix2D.h"
+#include "SegmentTree2D.h"
+
+/* Files of Matrix2D and SegmentTree2D in the format of BinaryFile.h.
+   Kept out of the containers' headers because reading maps the file with
+   POSIX calls; only code that writes or reads files includes this one.
+
+   BinaryIO::save(matrix, "matrix.bin");
+   Matrix2D<int> copy = BinaryIO::loadMatrix2D<int>("matrix.bin");
+
+   BinaryIO::save(seg, "grid.bin");
+   MappedSegmentTree2D<int, SumMonoid<int>> mapped("grid.bin");
+   int a = mapped.query(1, 2, 1, 2);
+ */
+namespace BinaryIO {
+    // writes the matrix row by row
+    template<typename T>
+    void save(const Matrix2D<T>& matrix, const std::string& path) {
+        static_assert(std::is_trivially_copyable<T>::value, "elements must be trivially copyable");
+        const auto size = matrix.size();
+        BinaryFile::write(path, BinaryFile::MATRIX, size.second, size.first,
+                          matrix.data(), size.first * size.second);
+    }
+
+    template<typename T>
+    Matrix2D<T> loadMatrix2D(const std::string& path) {
+        MappedFile file(path);
+        const BinaryFile::Header& header = BinaryFile::open<T>(file, BinaryFile::MATRIX);
+        if (header.count != header.columns * header.rows) {
+            throw std::runtime_error("file holds another type");
+        }
+        const T* data = BinaryFile::payload<T>(file);
+        Matrix2D<T> result(header.rows, header.columns);
+        std::copy(data, data + header.count, result.data());
+        return result;
+    }
+
+    // writes the flat tree, MappedSegmentTree2D queries it without a rebuild
+    template<typename T, typename Op>
+    void save(const SegmentTree2D<T, Op>& tree, const std::string& path) {
+        static_assert(std::is_trivially_copyable<T>::value, "elements must be trivially copyable");
+        BinaryFile::write(path, BinaryFile::SEGMENT_TREE_2D, tree.columnsSize(), tree.rowsSize(),
+                          tree.data(), 4 * tree.columnsSize() * tree.rowsSize());
+    }
+}
+
+// SegmentTree2D saved by BinaryIO::save, mapped read-only and queried in place.
+// the file has to be written with the same 'T' and 'Op'
+template<typename T, typename Op = FunctionMonoid<T>>
+class MappedSegmentTree2D {
+public:
+    explicit MappedSegmentTree2D(const std::string& path, const Op& operation = Op(),
+                                 const bool verifyChecksum = true) :
+        file(path),
+        tree(open(file, operation, verifyChecksum)) { }
+
+    explicit MappedSegmentTree2D(const std::string& path, T function(const T&, const T&),
+                                 const T& identityElement, const bool verifyChecksum = true) :
+        MappedSegmentTree2D(path, Op(function, identityElement), verifyChecksum) { }
+
+    // get query on range [fromColumn, toColumn], [fromRow, toRow]
+    T query(const size_t fromColumn, const size_t toColumn,
+            const size_t fromRow, const size_t toRow) const {
+        return tree.query(fromColumn, toColumn, fromRow, toRow);
+    }
+
+    size_t columnsSize() const {
+        return columns;
+    }
+
+    size_t rowsSize() const {
+        return rows;
+    }
+
+private:
+    MappedFile file;
+    size_t columns = 0;
+    size_t rows = 0;
+    SegmentTree2DView<T, Op> tree;
+
+    SegmentTree2DView<T, Op> open(const MappedFile& mapped, const Op& operation, const bool verifyChecksum) {
+        const BinaryFile::Header& header =
+            BinaryFile::open<T>(mapped, BinaryFile::SEGMENT_TREE_2D, verifyChecksum);
+        columns = header.columns;
+        rows = header.rows;
+        if (header.count != 4 * header.columns * header.rows) {
+            throw std::runtime_error("file holds another type");
+        }
+        return SegmentTree2DView<T, Op>(BinaryFile::payload<T>(mapped), columns, rows, operation);
+    }
+};
@@ -0,0 +1,297 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+#include <stdexcept>
+#include <algorithm>
+#include "Monoid.h"
+
+/* SegmentTree2D for huge grids whose touched points are known up front (offline).
+   Columns and rows are compressed to the coordinates of the declared points.
+   A bottom-up segment tree over the columns keeps, in every column node, the
+   sorted rows of the points below it and a bottom-up row tree over just those
+   rows, all in flat buffers. A point is stored once per column level, so memory
+   is O(k log k) for k points: (log2 k + 1) * (4 + 2 * sizeof(T)) bytes per point,
+   about 0.5 KB for 10^7 int64 points, where SparseSegmentTree2D needs ~400 nodes.
+   update() accepts only declared points, query() costs O(log^2 k).
+   Cells without a point read as the identity of 'Op'.
+
+   using Tree = CompressedSegmentTree2D<int64_t, SumMonoid<int64_t>>;
+   Tree seg(1'000'000, 1'000'000, {{12, 400'000, 7}, {90, 5, 1}});
+   seg.update(12, 400'000, 3);
+   int64_t a = seg.query(0, 100, 0, 999'999);
+ */
+template<typename T, typename Op>
+class CompressedSegmentTree2D {
+public:
+    struct Point {
+        size_t column;
+        size_t row;
+        T value;
+    };
+
+    // later duplicates of a point win
+    CompressedSegmentTree2D(const size_t columnsCount, const size_t rowsCount,
+                            const std::vector<Point>& points, const Op& operation = Op()) :
+        columns(columnsCount),
+        rows(rowsCount),
+        op(operation),
+        id(operation.identity()) {
+        if (points.size() >= UINT32_MAX) {
+            throw std::length_error("too many points");
+        }
+        for (const Point& point : points) {
+            if (point.column >= columns || point.row >= rows) {
+                throw std::out_of_range("index out of range");
+            }
+            columnKeys.push_back(point.column);
+            rowKeys.push_back(point.row);
+        }
+        compress(columnKeys);
+        compress(rowKeys);
+        build(points);
+    }
+
+    // get query on range [fromColumn, toColumn], [fromRow, toRow]
+    T query(const size_t fromColumn, const size_t toColumn,
+            const size_t fromRow, const size_t toRow) const {
+        if (toColumn >= columns || toRow >= rows) {
+            throw std::out_of_range("index out of range");
+        }
+        if (fromColumn > toColumn || fromRow > toRow) {
+            return id;
+        }
+        const uint32_t lowerRow = position(rowKeys, fromRow);
+        const uint32_t upperRow = position(rowKeys, toRow + 1);
+        T leftResult = id;
+        T rightResult = id;
+        size_t lower = position(columnKeys, fromColumn) + leaves;
+        size_t upper = position(columnKeys, toColumn + 1) + leaves;
+        while (lower < upper) {
+            if (lower & 1) {
+                leftResult = op(leftResult, queryRows(lower++, lowerRow, upperRow));
+            }
+            if (upper & 1) {
+                rightResult = op(queryRows(--upper, lowerRow, upperRow), rightResult);
+            }
+            lower >>= 1;
+            upper >>= 1;
+        }
+        return op(leftResult, rightResult);
+    }
+
+    // the point has to be one of those given to the constructor
+    void update(const size_t column, const size_t row, const T& newValue) {
+        if (column >= columns || row >= rows) {
+            throw std::out_of_range("index out of range");
+        }
+        const uint32_t columnId = position(columnKeys, column);
+        const uint32_t rowId = position(rowKeys, row);
+        if (columnId == columnKeys.size() || columnKeys[columnId] != column ||
+            rowId == rowKeys.size() || rowKeys[rowId] != row) {
+            throw std::invalid_argument("point was not declared");
+        }
+        size_t x = columnId + leaves;
+        T value = newValue;
+        while (true) {
+            const size_t slot = find(x, rowId);
+            if (slot == NOT_FOUND) {
+                throw std::invalid_argument("point was not declared");
+            }
+            setRow(x, slot, value);
+            if (x == 1) {
+                break;
+            }
+            x >>= 1;
+            value = op(valueAt(2 * x, rowId), valueAt(2 * x + 1, rowId));
+        }
+    }
+
+    size_t columnsSize() const {
+        return columns;
+    }
+
+    size_t rowsSize() const {
+        return rows;
+    }
+
+    // number of stored (column node, row) entries, each takes two cells
+    size_t entriesCount() const {
+        return rowIds.size();
+    }
+
+private:
+    static constexpr size_t NOT_FOUND = SIZE_MAX;
+
+    size_t columns;
+    size_t rows;
+    Op op;
+    T id;
+    // sorted distinct coordinates of the points
+    std::vector<size_t> columnKeys;
+    std::vector<size_t> rowKeys;
+    size_t leaves = 0;
+    // column node x owns entries [begin[x], end[x]) of 'rowIds': the leaves first,
+    // then the inner nodes from the largest index down. its row tree is cells
+    // [2 * begin[x], 2 * end[x]): slot 0 unused, the entries' values from count(x) on
+    std::vector<size_t> begin;
+    std::vector<size_t> end;
+    std::vector<uint32_t> rowIds;
+    std::vector<T> cells;
+
+    static void compress(std::vector<size_t>& keys) {
+        std::sort(keys.begin(), keys.end());
+        keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+    }
+
+    // number of keys less than 'key'
+    static uint32_t position(const std::vector<size_t>& keys, const size_t key) {
+        return static_cast<uint32_t>(std::lower_bound(keys.begin(), keys.end(), key) - keys.begin());
+    }
+
+    size_t count(const size_t x) const {
+        return end[x] - begin[x];
+    }
+
+    T& cell(const size_t x, const size_t index) {
+        return cells[2 * begin[x] + index];
+    }
+
+    const T& cell(const size_t x, const size_t index) const {
+        return cells[2 * begin[x] + index];
+    }
+
+    // slot of compressed row 'rowId' among the entries of node x
+    size_t find(const size_t x, const uint32_t rowId) const {
+        const auto first = rowIds.begin() + begin[x];
+        const auto last = rowIds.begin() + end[x];
+        const auto it = std::lower_bound(first, last, rowId);
+        return it != last && *it == rowId ? static_cast<size_t>(it - first) : NOT_FOUND;
+    }
+
+    T valueAt(const size_t x, const uint32_t rowId) const {
+        if (x >= 2 * leaves) {
+            return id;
+        }
+        const size_t slot = find(x, rowId);
+        return slot == NOT_FOUND ? id : cell(x, count(x) + slot);
+    }
+
+    void setRow(const size_t x, size_t slot, const T& value) {
+        const size_t size = count(x);
+        slot += size;
+        cell(x, slot) = value;
+        for (slot >>= 1; slot > 0; slot >>= 1) {
+            cell(x, slot) = op(cell(x, 2 * slot), cell(x, 2 * slot + 1));
+        }
+    }
+
+    // result over entries of node x whose rows are in [lowerRow, upperRow)
+    T queryRows(const size_t x, const uint32_t lowerRow, const uint32_t upperRow) const {
+        const auto first = rowIds.begin() + begin[x];
+        const auto last = rowIds.begin() + end[x];
+        const size_t size = count(x);
+        size_t lower = std::lower_bound(first, last, lowerRow) - first + size;
+        size_t upper = std::lower_bound(first, last, upperRow) - first + size;
+        T leftResult = id;
+        T rightResult = id;
+        while (lower < upper) {
+            if (lower & 1) {
+                leftResult = op(leftResult, cell(x, lower++));
+            }
+            if (upper & 1) {
+                rightResult = op(cell(x, --upper), rightResult);
+            }
+            lower >>= 1;
+            upper >>= 1;
+        }
+        return op(leftResult, rightResult);
+    }
+
+    // the rows of a column node are the union of its children's rows, so nodes
+    // are built from the largest index down; each node's leaf values combine
+    // the children's values row by row, then its row tree is filled bottom-up
+    void build(const std::vector<Point>& points) {
+        leaves = columnKeys.size();
+        if (leaves == 0) {
+            return;
+        }
+        // compressed (column, row, index) of every point, sorted
+        std::vector<std::pair<uint64_t, uint32_t>> sorted(points.size());
+        for (size_t i = 0; i < points.size(); ++i) {
+            const uint64_t key = uint64_t(position(columnKeys, points[i].column)) << 32 |
+                                 position(rowKeys, points[i].row);
+            sorted[i] = {key, static_cast<uint32_t>(i)};
+        }
+        std::sort(sorted.begin(), sorted.end());
+        begin.assign(2 * leaves, 0);
+        end.assign(2 * leaves, 0);
+        for (size_t i = 0; i < sorted.size(); ++i) {
+            const size_t x = (sorted[i].first >> 32) + leaves;
+            const uint32_t rowId = static_cast<uint32_t>(sorted[i].first);
+            if (i == 0 || (sorted[i - 1].first >> 32) + leaves != x) {
+                begin[x] = rowIds.size();
+            }
+            if (rowIds.size() == begin[x] || rowIds.back() != rowId) {
+                rowIds.push_back(rowId);
+            }
+            end[x] = rowIds.size();
+        }
+        for (size_t x = leaves - 1; x > 0; --x) {
+            begin[x] = rowIds.size();
+            size_t left = begin[2 * x];
+            size_t right = begin[2 * x + 1];
+            while (left < end[2 * x] || right < end[2 * x + 1]) {
+                uint32_t rowId;
+                if (right == end[2 * x + 1] || (left < end[2 * x] && rowIds[left] < rowIds[right])) {
+                    rowId = rowIds[left++];
+                } else if (left == end[2 * x] || rowIds[right] < rowIds[left]) {
+                    rowId = rowIds[right++];
+                } else {
+                    rowId = rowIds[left++];
+                    ++right;
+                }
+                rowIds.push_back(rowId);
+            }
+            end[x] = rowIds.size();
+        }
+        rowIds.shrink_to_fit();
+        cells.assign(2 * rowIds.size(), id);
+        // leaf columns take the point values, later duplicates win
+        for (const auto& entry : sorted) {
+            const size_t x = (entry.first >> 32) + leaves;
+            const size_t slot = find(x, static_cast<uint32_t>(entry.first));
+            cell(x, count(x) + slot) = points[entry.second].value;
+        }
+        for (size_t x = 2 * leaves - 1; x > 0; --x) {
+            const size_t size = count(x);
+            if (x < leaves) {
+                combineChildren(x);
+            }
+            for (size_t slot = size - 1; slot > 0; --slot) {
+                cell(x, slot) = op(cell(x, 2 * slot), cell(x, 2 * slot + 1));
+            }
+        }
+    }
+
+    // leaf values of inner node x from the leaf values of its two children
+    void combineChildren(const size_t x) {
+        const size_t size = count(x);
+        size_t left = 0;
+        size_t right = 0;
+        const size_t leftSize = count(2 * x);
+        const size_t rightSize = count(2 * x + 1);
+        const uint32_t* leftRows = rowIds.data() + begin[2 * x];
+        const uint32_t* rightRows = rowIds.data() + begin[2 * x + 1];
+        for (size_t slot = 0; slot < size; ++slot) {
+            const uint32_t rowId = rowIds[begin[x] + slot];
+            T value = id;
+            if (left < leftSize && leftRows[left] == rowId) {
+                value = cell(2 * x, leftSize + left++);
+            }
+            if (right < rightSize && rightRows[right] == rowId) {
+                value = op(value, cell(2 * x + 1, rightSize + right++));
+            }
+            cell(x, size + slot) = value;
+        }
+    }
+};
@@ -0,0 +1,193 @@
+#pragma once
+#include <atomic>
+#include <memory>
+#include <vector>
+#include <cstdint>
+#include <stdexcept>
+#include <algorithm>
+#include "ThreadPool.h"
+
+// DisjointSetUnion over compact 0..n-1 ids that can be shared between threads
+// without locking. Every element keeps its parent index in an atomic word,
+// a root points to itself. Roots are linked by CAS in a fixed pseudo-random
+// order of ids (so no rank has to be updated together with the parent),
+// finds split paths with relaxed CAS that may fail harmlessly.
+// Both find and union are lock-free, not wait-free: some thread always makes
+// progress, but a single find can be made to chase roots that keep getting
+// linked under it, and a union retries its CAS whenever it loses a race.
+class ConcurrentDisjointSetUnion {
+public:
+    ConcurrentDisjointSetUnion() { }
+    explicit ConcurrentDisjointSetUnion(size_t setsCount) : count(setsCount) {
+        if (setsCount > MAX_SIZE) {
+            throw std::length_error("too many sets");
+        }
+        base.reset(new std::atomic<uint32_t>[setsCount]);
+        for (size_t i = 0; i < count; i++) {
+            base[i].store(static_cast<uint32_t>(i), std::memory_order_relaxed);
+        }
+    }
+
+    ConcurrentDisjointSetUnion(const ConcurrentDisjointSetUnion& other) = delete;
+    ConcurrentDisjointSetUnion(ConcurrentDisjointSetUnion&& other) :
+        base(std::move(other.base)),
+        count(other.count) {
+        other.count = 0;
+    }
+
+    // turns 'set' back into a singleton, must not race with operations touching it
+    void makeSet(uint32_t set) {
+        check(set);
+        base[set].store(set, std::memory_order_release);
+    }
+
+    uint32_t findSet(uint32_t set) {
+        check(set);
+        return findRoot(set);
+    }
+
+    // returns false if both elements were already in one set
+    bool unionSets(uint32_t first, uint32_t second) {
+        check(first);
+        check(second);
+        return link(first, second);
+    }
+
+    // unions the pairs on the shared ThreadPool, returns the number of merges
+    size_t unionBatch(const std::vector<std::pair<uint32_t, uint32_t>>& pairs) {
+        for (const auto& pair : pairs) {
+            check(pair.first);
+            check(pair.second);
+        }
+        std::atomic<size_t> merged(0);
+        ThreadPool::shared().parallelFor(0, pairs.size(), MIN_BATCH, [&](size_t from, size_t to) {
+            size_t local = 0;
+            for (size_t i = from; i < to; i++) {
+                local += link(pairs[i].first, pairs[i].second);
+            }
+            merged.fetch_add(local, std::memory_order_relaxed);
+        });
+        return merged.load(std::memory_order_relaxed);
+    }
+
+    struct Components {
+        // compact 0..k-1 label of every element
+        std::vector<uint32_t> labels;
+        // number of elements in every component, indexed by label
+        std::vector<size_t> sizes;
+    };
+
+    // labels all components in one sweep; roots are labelled in id order.
+    // must not run concurrently with unions
+    Components components() {
+        Components result;
+        result.labels.resize(count);
+        for (uint32_t set = 0; set < count; set++) {
+            if (base[set].load(std::memory_order_relaxed) == set) {
+                result.labels[set] = static_cast<uint32_t>(result.sizes.size());
+                result.sizes.push_back(0);
+            }
+        }
+        for (uint32_t set = 0; set < count; set++) {
+            result.labels[set] = result.labels[findRoot(set)];
+            ++result.sizes[result.labels[set]];
+        }
+        return result;
+    }
+
+    // linearizable: 'false' is only returned if 'first' was still a root
+    // after both finds, so the two sets were separate at that moment
+    bool sameSet(uint32_t first, uint32_t second) {
+        check(first);
+        check(second);
+        while (true) {
+            first = findRoot(first);
+            second = findRoot(second);
+            if (first == second) {
+                return true;
+            }
+            if (base[first].load(std::memory_order_acquire) == first) {
+                return false;
+            }
+        }
+    }
+
+    size_t size() const {
+        return count;
+    }
+
+    ConcurrentDisjointSetUnion& operator=(const ConcurrentDisjointSetUnion& other) = delete;
+
+    ConcurrentDisjointSetUnion& operator=(ConcurrentDisjointSetUnion&& other) {
+        base = std::move(other.base);
+        count = other.count;
+        other.count = 0;
+        return *this;
+    }
+
+private:
+    static constexpr size_t MAX_SIZE = UINT32_MAX;
+    // a union is a few cache misses on random parents, so a chunk this long runs
+    // for about a millisecond and dwarfs the cost of handing it to a pool worker
+    static constexpr size_t MIN_BATCH = 1 << 14;
+
+    std::unique_ptr<std::atomic<uint32_t>[]> base;
+    size_t count = 0;
+
+    void check(uint32_t set) const {
+        if (set >= count) {
+            throw std::out_of_range("set does not exist");
+        }
+    }
+
+    static uint32_t mix(uint32_t x) {
+        x ^= x >> 16;
+        x *= 0x85ebca6bu;
+        x ^= x >> 13;
+        x *= 0xc2b2ae35u;
+        x ^= x >> 16;
+        return x;
+    }
+
+    // order in which roots are linked: the earlier root becomes the child
+    static bool before(uint32_t first, uint32_t second) {
+        const uint32_t firstKey = mix(first);
+        const uint32_t secondKey = mix(second);
+        return firstKey < secondKey || (firstKey == secondKey && first < second);
+    }
+
+    bool link(uint32_t first, uint32_t second) {
+        while (true) {
+            first = findRoot(first);
+            second = findRoot(second);
+            if (first == second) {
+                return false;
+            }
+            if (before(second, first)) {
+                std::swap(first, second);
+            }
+            uint32_t expected = first;
+            if (base[first].compare_exchange_strong(expected, second,
+                                                    std::memory_order_acq_rel)) {
+                return true;
+            }
+        }
+    }
+
+    // path splitting: every visited element is pointed to its grandparent
+    uint32_t findRoot(uint32_t set) {
+        while (true) {
+            uint32_t parent = base[set].load(std::memory_order_acquire);
+            if (parent == set) {
+                return set;
+            }
+            const uint32_t grandparent = base[parent].load(std::memory_order_acquire);
+            if (parent != grandparent) {
+                base[set].compare_exchange_weak(parent, grandparent,
+                                                std::memory_order_release,
+                                                std::memory_order_relaxed);
+            }
+            set = parent;
+        }
+    }
+};
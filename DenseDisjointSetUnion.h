@@ -0,0 +1,149 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+#include <stdexcept>
+#include <algorithm>
+
+// DisjointSetUnion over compact 0..n-1 ids.
+// Every set is one 32-bit word: a root keeps its set size with the high bit set,
+// any other element keeps the index of its parent.
+class DenseDisjointSetUnion {
+public:
+    DenseDisjointSetUnion() { }
+    explicit DenseDisjointSetUnion(size_t count) {
+        makeSets(count);
+    }
+
+    DenseDisjointSetUnion(const DenseDisjointSetUnion& other) : base(other.base) { }
+    DenseDisjointSetUnion(DenseDisjointSetUnion&& other) : base(std::move(other.base)) { }
+
+    void reserve(size_t count) {
+        base.reserve(count);
+    }
+
+    // creates a singleton set and returns its id
+    uint32_t makeSet() {
+        return makeSets(1);
+    }
+
+    // creates 'count' singleton sets and returns the id of the first one
+    uint32_t makeSets(size_t count) {
+        const size_t first = base.size();
+        if (count > MAX_SIZE - first) {
+            throw std::length_error("too many sets");
+        }
+        base.resize(first + count, ROOT_FLAG | 1);
+        return static_cast<uint32_t>(first);
+    }
+
+    // finds the root and halves the path on the way
+    uint32_t findSet(uint32_t set) {
+        check(set);
+        while (!isRoot(base[set])) {
+            const uint32_t parent = base[set];
+            if (!isRoot(base[parent])) {
+                base[set] = base[parent];
+            }
+            set = parent;
+        }
+        return set;
+    }
+
+    // read-only lookup, leaves the forest untouched
+    uint32_t findSet(uint32_t set) const {
+        check(set);
+        while (!isRoot(base[set])) {
+            set = base[set];
+        }
+        return set;
+    }
+
+    // returns false if both elements were already in one set
+    bool unionSets(uint32_t first, uint32_t second) {
+        uint32_t firstParent = findSet(first);
+        uint32_t secondParent = findSet(second);
+        if (firstParent == secondParent) {
+            return false;
+        }
+        if (base[firstParent] < base[secondParent]) {
+            std::swap(firstParent, secondParent);
+        }
+        base[firstParent] += base[secondParent] & ~ROOT_FLAG;
+        base[secondParent] = firstParent;
+        return true;
+    }
+
+    // unions every pair in order, returns the number of merges
+    size_t unionBatch(const std::vector<std::pair<uint32_t, uint32_t>>& pairs) {
+        size_t merged = 0;
+        for (const auto& pair : pairs) {
+            merged += unionSets(pair.first, pair.second);
+        }
+        return merged;
+    }
+
+    struct Components {
+        // compact 0..k-1 label of every element
+        std::vector<uint32_t> labels;
+        // number of elements in every component, indexed by label
+        std::vector<size_t> sizes;
+    };
+
+    // labels all components in one sweep; roots are labelled in id order
+    Components components() {
+        Components result;
+        result.labels.resize(base.size());
+        for (uint32_t set = 0; set < base.size(); set++) {
+            if (isRoot(base[set])) {
+                result.labels[set] = static_cast<uint32_t>(result.sizes.size());
+                result.sizes.push_back(base[set] & ~ROOT_FLAG);
+            }
+        }
+        for (uint32_t set = 0; set < base.size(); set++) {
+            result.labels[set] = result.labels[findSet(set)];
+        }
+        return result;
+    }
+
+    bool sameSet(uint32_t first, uint32_t second) {
+        return findSet(first) == findSet(second);
+    }
+
+    size_t setSize(uint32_t set) {
+        return base[findSet(set)] & ~ROOT_FLAG;
+    }
+
+    size_t size() const {
+        return base.size();
+    }
+
+    void clear() {
+        base.clear();
+    }
+
+    DenseDisjointSetUnion& operator=(const DenseDisjointSetUnion& other) {
+        base = other.base;
+        return *this;
+    }
+
+    DenseDisjointSetUnion& operator=(DenseDisjointSetUnion&& other) {
+        base = std::move(other.base);
+        return *this;
+    }
+
+private:
+    static constexpr uint32_t ROOT_FLAG = 0x80000000u;
+    static constexpr size_t MAX_SIZE = ROOT_FLAG;
+
+    std::vector<uint32_t> base;
+
+    static bool isRoot(uint32_t word) {
+        return word & ROOT_FLAG;
+    }
+
+    void check(uint32_t set) const {
+        if (set >= base.size()) {
+            throw std::out_of_range("set does not exist");
+        }
+    }
+};
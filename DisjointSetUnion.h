@@ -1,8 +1,10 @@
 #pragma once
 #include <unordered_map>
+#include <vector>
 #include <iostream>
 #include <cstdint>
 #include <algorithm>
+#include <stdexcept>
 
 template<typename Set>
 class DisjointSetUnion {
@@ -16,27 +18,75 @@ public:
         base[set] = {set, 0};
     }
 
+    // finds the root and compresses the whole path to it
+    Set findSet(const Set& set) {
+        return findRoot(set)->first;
+    }
+
+    // read-only lookup, leaves the forest untouched
     Set findSet(const Set& set) const {
-        Node parentNode = base.at(set);
-        if (set == parentNode.parent) {
-            return set;
+        auto current = base.find(set);
+        checkExists(current);
+        while (!(current->first == current->second.parent)) {
+            current = base.find(current->second.parent);
         }
-        parentNode.parent = findSet(parentNode.parent);
-        return parentNode.parent;
+        return current->first;
     }
 
-    void unionSets(const Set& first, const Set& second) {
-        Set firstParent = findSet(first);
-        Set secondParent = findSet(second);
-        if (firstParent != secondParent) {
-            if (base[firstParent].rank < base[secondParent].rank) {
-                std::swap(firstParent, secondParent);
+    // returns false if both elements were already in one set
+    bool unionSets(const Set& first, const Set& second) {
+        Entry* firstParent = findRoot(first);
+        Entry* secondParent = findRoot(second);
+        if (firstParent == secondParent) {
+            return false;
+        }
+        if (firstParent->second.rank < secondParent->second.rank) {
+            std::swap(firstParent, secondParent);
+        }
+        secondParent->second.parent = firstParent->first;
+        if (firstParent->second.rank == secondParent->second.rank) {
+            ++firstParent->second.rank;
+        }
+        return true;
+    }
+
+    // unions every pair in order, returns the number of merges
+    size_t unionBatch(const std::vector<std::pair<Set, Set>>& pairs) {
+        size_t merged = 0;
+        for (const auto& pair : pairs) {
+            merged += unionSets(pair.first, pair.second);
+        }
+        return merged;
+    }
+
+    struct Components {
+        // compact 0..k-1 label of every set
+        std::unordered_map<Set, size_t> labels;
+        // number of elements in every component, indexed by label
+        std::vector<size_t> sizes;
+    };
+
+    // labels all components in one sweep over the map
+    Components components() {
+        Components result;
+        result.labels.reserve(base.size());
+        for (auto& entry : base) {
+            if (entry.first == entry.second.parent) {
+                result.labels.emplace(entry.first, result.sizes.size());
+                result.sizes.push_back(0);
             }
-            base[secondParent].parent = firstParent;
-            if (base[firstParent].rank == base[secondParent].rank) {
-                ++base[firstParent].rank;
+        }
+        for (auto& entry : base) {
+            const Entry* root = findRoot(entry.first);
+            if (root != &entry) {
+                const size_t label = result.labels.at(root->first);
+                result.labels.emplace(entry.first, label);
             }
         }
+        for (const auto& label : result.labels) {
+            ++result.sizes[label.second];
+        }
+        return result;
     }
 
     size_t size() const {
@@ -63,5 +113,31 @@ private:
         uint64_t rank;
     };
 
-    std::unordered_map<Set, Node> base;
+    using Base = std::unordered_map<Set, Node>;
+    using Entry = typename Base::value_type;
+
+    Base base;
+
+    void checkExists(typename Base::const_iterator it) const {
+        if (it == base.end()) {
+            throw std::out_of_range("set does not exist");
+        }
+    }
+
+    // two passes instead of recursion: locate the root, then relink the path
+    Entry* findRoot(const Set& set) {
+        auto it = base.find(set);
+        checkExists(it);
+        Entry* root = &*it;
+        while (!(root->first == root->second.parent)) {
+            root = &*base.find(root->second.parent);
+        }
+        Entry* current = &*it;
+        while (current != root) {
+            Entry* next = &*base.find(current->second.parent);
+            current->second.parent = root->first;
+            current = next;
+        }
+        return root;
+    }
 };
\ No newline at end of file
@@ -0,0 +1,142 @@
+#pragma once
+#include <vector>
+#include <map>
+#include <cstdint>
+#include <stdexcept>
+#include <algorithm>
+#include "RollbackDisjointSetUnion.h"
+
+/* Offline dynamic connectivity.
+   Record edge insertions, deletions and connectivity queries in order,
+   then solve() answers every query at once.
+
+   Every edge is alive on a contiguous interval of queries; the interval is
+   put into a segment tree over query indices and the tree is walked with a
+   RollbackDisjointSetUnion, so the total cost is O((m log q) log n).
+
+   DynamicConnectivity graph(4);
+   graph.addEdge(0, 1);
+   graph.query(0, 1);      // true
+   graph.removeEdge(0, 1);
+   graph.query(0, 1);      // false
+   std::vector<bool> answers = graph.solve();
+ */
+class DynamicConnectivity {
+public:
+    explicit DynamicConnectivity(size_t vertices) : vertices(vertices) { }
+
+    void addEdge(uint32_t first, uint32_t second) {
+        check(first, second);
+        openEdges[normalize(first, second)].push_back(queries.size());
+    }
+
+    // removes one copy of the edge, throws if the edge is not present
+    void removeEdge(uint32_t first, uint32_t second) {
+        check(first, second);
+        auto it = openEdges.find(normalize(first, second));
+        if (it == openEdges.end()) {
+            throw std::invalid_argument("edge does not exist");
+        }
+        addInterval(it->first, it->second.back(), queries.size());
+        it->second.pop_back();
+        if (it->second.empty()) {
+            openEdges.erase(it);
+        }
+    }
+
+    // asks whether 'first' and 'second' are connected at this point
+    void query(uint32_t first, uint32_t second) {
+        check(first, second);
+        queries.push_back({first, second});
+    }
+
+    std::vector<bool> solve() const {
+        std::vector<bool> answers(queries.size());
+        if (queries.empty()) {
+            return answers;
+        }
+        std::vector<std::vector<Edge>> segmentTree(4 * queries.size());
+        for (const Interval& interval : intervals) {
+            insert(segmentTree, 1, 0, queries.size() - 1, interval);
+        }
+        for (const auto& open : openEdges) {
+            for (size_t from : open.second) {
+                if (from < queries.size()) {
+                    insert(segmentTree, 1, 0, queries.size() - 1,
+                           {open.first, from, queries.size()});
+                }
+            }
+        }
+        RollbackDisjointSetUnion dsu(vertices);
+        walk(segmentTree, dsu, answers, 1, 0, queries.size() - 1);
+        return answers;
+    }
+
+    void clear() {
+        openEdges.clear();
+        intervals.clear();
+        queries.clear();
+    }
+
+private:
+    using Edge = std::pair<uint32_t, uint32_t>;
+
+    // edge is alive for queries [from, to)
+    struct Interval {
+        Edge edge;
+        size_t from;
+        size_t to;
+    };
+
+    size_t vertices;
+    std::map<Edge, std::vector<size_t>> openEdges;
+    std::vector<Interval> intervals;
+    std::vector<Edge> queries;
+
+    void check(uint32_t first, uint32_t second) const {
+        if (first >= vertices || second >= vertices) {
+            throw std::out_of_range("vertex does not exist");
+        }
+    }
+
+    static Edge normalize(uint32_t first, uint32_t second) {
+        return {std::min(first, second), std::max(first, second)};
+    }
+
+    void addInterval(const Edge& edge, size_t from, size_t to) {
+        if (from < to) {
+            intervals.push_back({edge, from, to});
+        }
+    }
+
+    static void insert(std::vector<std::vector<Edge>>& segmentTree, size_t index,
+                       size_t lower, size_t upper, const Interval& interval) {
+        if (interval.to <= lower || upper < interval.from) {
+            return;
+        }
+        if (interval.from <= lower && upper < interval.to) {
+            segmentTree[index].push_back(interval.edge);
+            return;
+        }
+        const size_t medium = (lower + upper) / 2;
+        insert(segmentTree, 2 * index, lower, medium, interval);
+        insert(segmentTree, 2 * index + 1, medium + 1, upper, interval);
+    }
+
+    void walk(const std::vector<std::vector<Edge>>& segmentTree,
+              RollbackDisjointSetUnion& dsu, std::vector<bool>& answers,
+              size_t index, size_t lower, size_t upper) const {
+        const size_t mark = dsu.checkpoint();
+        for (const Edge& edge : segmentTree[index]) {
+            dsu.unionSets(edge.first, edge.second);
+        }
+        if (lower == upper) {
+            answers[lower] = dsu.sameSet(queries[lower].first, queries[lower].second);
+        } else {
+            const size_t medium = (lower + upper) / 2;
+            walk(segmentTree, dsu, answers, 2 * index, lower, medium);
+            walk(segmentTree, dsu, answers, 2 * index + 1, medium + 1, upper);
+        }
+        dsu.rollbackTo(mark);
+    }
+};
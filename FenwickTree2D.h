@@ -0,0 +1,122 @@
+#pragma once
+#include <vector>
+#include <stdexcept>
+#include <algorithm>
+#include "Monoid.h"
+
+/* 2D Fenwick (binary indexed) tree for invertible operations, see Monoid.h.
+   Exactly columns * rows cells in one buffer, O(log C * log R) point
+   updates and rectangle queries, O(C * R) build from a matrix.
+   Ranges are inclusive, as in SegmentTree2D.
+
+   FenwickTree2D<int64_t> tree(matrix);
+   tree.add(1, 2, 5);
+   int64_t sum = tree.query(0, 1, 1, 2);
+ */
+template<typename T, typename Op = SumMonoid<T>>
+class FenwickTree2D {
+public:
+    FenwickTree2D(const size_t columnsCount, const size_t rowsCount,
+                  const Op& operation = Op()) :
+        columns(columnsCount),
+        rows(rowsCount),
+        op(operation),
+        tree(columnsCount * rowsCount, operation.identity()) { }
+
+    explicit FenwickTree2D(const std::vector<std::vector<T>>& matrix,
+                           const Op& operation = Op()) :
+        FenwickTree2D(matrix.size(), matrix.empty() ? 0 : matrix.at(0).size(), operation) {
+        build(matrix);
+    }
+
+    // combines 'delta' into the cell
+    void add(const size_t column, const size_t row, const T& delta) {
+        check(column, row);
+        for (size_t x = column + 1; x <= columns; x += x & (~x + 1)) {
+            T* line = tree.data() + (x - 1) * rows;
+            for (size_t y = row + 1; y <= rows; y += y & (~y + 1)) {
+                line[y - 1] = op(line[y - 1], delta);
+            }
+        }
+    }
+
+    void update(const size_t column, const size_t row, const T& newValue) {
+        add(column, row, op(newValue, Op::inverse(query(column, column, row, row))));
+    }
+
+    // get query on range [0, toColumn], [0, toRow]
+    T prefixQuery(const size_t toColumn, const size_t toRow) const {
+        check(toColumn, toRow);
+        return prefix(toColumn + 1, toRow + 1);
+    }
+
+    // get query on range [fromColumn, toColumn], [fromRow, toRow],
+    // an empty range gives the identity as in SegmentTree2D
+    T query(const size_t fromColumn, const size_t toColumn,
+            const size_t fromRow, const size_t toRow) const {
+        check(toColumn, toRow);
+        if (fromColumn > toColumn || fromRow > toRow) {
+            return op.identity();
+        }
+        const T inside = op(prefix(toColumn + 1, toRow + 1), prefix(fromColumn, fromRow));
+        const T outside = op(prefix(fromColumn, toRow + 1), prefix(toColumn + 1, fromRow));
+        return op(inside, Op::inverse(outside));
+    }
+
+    size_t columnsSize() const {
+        return columns;
+    }
+
+    size_t rowsSize() const {
+        return rows;
+    }
+
+private:
+    size_t columns;
+    size_t rows;
+    Op op;
+    // cell (x, y) of the 1-based tree is tree[(x - 1) * rows + y - 1]
+    std::vector<T> tree;
+
+    void check(const size_t column, const size_t row) const {
+        if (column >= columns || row >= rows) {
+            throw std::out_of_range("index out of range");
+        }
+    }
+
+    // result over the first x columns and y rows
+    T prefix(const size_t x, const size_t y) const {
+        T result = op.identity();
+        for (size_t i = x; i > 0; i &= i - 1) {
+            const T* line = tree.data() + (i - 1) * rows;
+            for (size_t j = y; j > 0; j &= j - 1) {
+                result = op(result, line[j - 1]);
+            }
+        }
+        return result;
+    }
+
+    // every cell is pushed once into its parent, first along rows, then along columns
+    void build(const std::vector<std::vector<T>>& matrix) {
+        for (size_t column = 0; column < columns; ++column) {
+            if (matrix[column].size() != rows) {
+                throw std::invalid_argument("rows have different sizes");
+            }
+            T* line = &tree[column * rows];
+            std::copy(matrix[column].begin(), matrix[column].end(), line);
+            for (size_t y = 1; y <= rows; ++y) {
+                const size_t parent = y + (y & (~y + 1));
+                if (parent <= rows) {
+                    line[parent - 1] = op(line[parent - 1], line[y - 1]);
+                }
+            }
+        }
+        for (size_t x = 1; x <= columns; ++x) {
+            const size_t parent = x + (x & (~x + 1));
+            if (parent <= columns) {
+                combineRows(op, &tree[(parent - 1) * rows], &tree[(parent - 1) * rows],
+                            &tree[(x - 1) * rows], rows);
+            }
+        }
+    }
+};
@@ -0,0 +1,338 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include <algorithm>
+#include <type_traits>
+#include "AlignedAllocator.h"
+#include "MatrixView.h"
+// GCC and Clang: kernels for newer x86 extensions through target attributes,
+// picked with __builtin_cpu_supports. other compilers get the generic kernel
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define GEMM_X86_DISPATCH 1
+#endif
+
+#if defined(__GNUC__)
+#define GEMM_ALWAYS_INLINE inline __attribute__((always_inline))
+#elif defined(_MSC_VER)
+#define GEMM_ALWAYS_INLINE __forceinline
+#else
+#define GEMM_ALWAYS_INLINE inline
+#endif
+
+/* Cache-blocked matrix multiply, c += a * b, used by Matrix2D::operator*.
+   The classic three-level blocking: a KC x NC slice of 'b' and an MC x KC
+   slice of 'a' are packed into contiguous zero-padded panels, then a
+   register-tiled MR x NR microkernel runs over them. Packing reads through
+   strides, so transposed and sub- views need no copies.
+
+   The microkernel is chosen once at run time from the CPU:
+    - float, double: AVX-512 or AVX2 + FMA intrinsics;
+    - int32, int64: the generic kernel compiled for AVX2 / AVX-512;
+    - anything else, or no x86 extensions: the portable generic kernel.
+   Only the kernels are compiled for the newer instruction sets, so the
+   header works without -mavx2 and the binary runs on older CPUs.
+
+   Matrix2D<double> a(n, n), b(n, n), c(n, n);
+   Gemm::multiply(a.view(), b.view().transposed(), c.view());
+ */
+namespace Gemm {
+    // MR x NR block of the product of a packed 'a' panel (k rows of MR) and
+    // a packed 'b' panel (k rows of NR), written to 'tile' row by row
+    template<typename T>
+    using Kernel = void (*)(size_t k, const T* a, const T* b, T* tile);
+
+    template<typename T>
+    struct KernelChoice {
+        Kernel<T> kernel;
+        size_t mr;
+        size_t nr;
+    };
+
+    template<typename T, size_t MR, size_t NR>
+    GEMM_ALWAYS_INLINE void genericKernelBody(const size_t k, const T* a, const T* b, T* tile) {
+        T accumulator[MR][NR] = { };
+        for (size_t p = 0; p < k; ++p) {
+            for (size_t i = 0; i < MR; ++i) {
+                const T value = a[p * MR + i];
+                for (size_t j = 0; j < NR; ++j) {
+                    accumulator[i][j] += value * b[p * NR + j];
+                }
+            }
+        }
+        for (size_t i = 0; i < MR; ++i) {
+            for (size_t j = 0; j < NR; ++j) {
+                tile[i * NR + j] = accumulator[i][j];
+            }
+        }
+    }
+
+    template<typename T, size_t MR, size_t NR>
+    void genericKernel(const size_t k, const T* a, const T* b, T* tile) {
+        genericKernelBody<T, MR, NR>(k, a, b, tile);
+    }
+
+#ifdef GEMM_X86_DISPATCH
+    // 6 x 8 doubles, two ymm accumulators per row
+    __attribute__((target("avx2,fma")))
+    inline void kernelAvx2(const size_t k, const double* a, const double* b, double* tile) {
+        __m256d c[6][2];
+        for (size_t i = 0; i < 6; ++i) {
+            c[i][0] = c[i][1] = _mm256_setzero_pd();
+        }
+        for (size_t p = 0; p < k; ++p, a += 6, b += 8) {
+            const __m256d b0 = _mm256_load_pd(b);
+            const __m256d b1 = _mm256_load_pd(b + 4);
+            for (size_t i = 0; i < 6; ++i) {
+                const __m256d value = _mm256_broadcast_sd(a + i);
+                c[i][0] = _mm256_fmadd_pd(value, b0, c[i][0]);
+                c[i][1] = _mm256_fmadd_pd(value, b1, c[i][1]);
+            }
+        }
+        for (size_t i = 0; i < 6; ++i) {
+            _mm256_store_pd(tile + i * 8, c[i][0]);
+            _mm256_store_pd(tile + i * 8 + 4, c[i][1]);
+        }
+    }
+
+    // 6 x 16 floats, two ymm accumulators per row
+    __attribute__((target("avx2,fma")))
+    inline void kernelAvx2(const size_t k, const float* a, const float* b, float* tile) {
+        __m256 c[6][2];
+        for (size_t i = 0; i < 6; ++i) {
+            c[i][0] = c[i][1] = _mm256_setzero_ps();
+        }
+        for (size_t p = 0; p < k; ++p, a += 6, b += 16) {
+            const __m256 b0 = _mm256_load_ps(b);
+            const __m256 b1 = _mm256_load_ps(b + 8);
+            for (size_t i = 0; i < 6; ++i) {
+                const __m256 value = _mm256_broadcast_ss(a + i);
+                c[i][0] = _mm256_fmadd_ps(value, b0, c[i][0]);
+                c[i][1] = _mm256_fmadd_ps(value, b1, c[i][1]);
+            }
+        }
+        for (size_t i = 0; i < 6; ++i) {
+            _mm256_store_ps(tile + i * 16, c[i][0]);
+            _mm256_store_ps(tile + i * 16 + 8, c[i][1]);
+        }
+    }
+
+    // 6 x 16 doubles, two zmm accumulators per row
+    __attribute__((target("avx512f")))
+    inline void kernelAvx512(const size_t k, const double* a, const double* b, double* tile) {
+        __m512d c[6][2];
+        for (size_t i = 0; i < 6; ++i) {
+            c[i][0] = c[i][1] = _mm512_setzero_pd();
+        }
+        for (size_t p = 0; p < k; ++p, a += 6, b += 16) {
+            const __m512d b0 = _mm512_load_pd(b);
+            const __m512d b1 = _mm512_load_pd(b + 8);
+            for (size_t i = 0; i < 6; ++i) {
+                const __m512d value = _mm512_set1_pd(a[i]);
+                c[i][0] = _mm512_fmadd_pd(value, b0, c[i][0]);
+                c[i][1] = _mm512_fmadd_pd(value, b1, c[i][1]);
+            }
+        }
+        for (size_t i = 0; i < 6; ++i) {
+            _mm512_store_pd(tile + i * 16, c[i][0]);
+            _mm512_store_pd(tile + i * 16 + 8, c[i][1]);
+        }
+    }
+
+    // 6 x 32 floats, two zmm accumulators per row
+    __attribute__((target("avx512f")))
+    inline void kernelAvx512(const size_t k, const float* a, const float* b, float* tile) {
+        __m512 c[6][2];
+        for (size_t i = 0; i < 6; ++i) {
+            c[i][0] = c[i][1] = _mm512_setzero_ps();
+        }
+        for (size_t p = 0; p < k; ++p, a += 6, b += 32) {
+            const __m512 b0 = _mm512_load_ps(b);
+            const __m512 b1 = _mm512_load_ps(b + 16);
+            for (size_t i = 0; i < 6; ++i) {
+                const __m512 value = _mm512_set1_ps(a[i]);
+                c[i][0] = _mm512_fmadd_ps(value, b0, c[i][0]);
+                c[i][1] = _mm512_fmadd_ps(value, b1, c[i][1]);
+            }
+        }
+        for (size_t i = 0; i < 6; ++i) {
+            _mm512_store_ps(tile + i * 32, c[i][0]);
+            _mm512_store_ps(tile + i * 32 + 16, c[i][1]);
+        }
+    }
+
+    // integer kernels: the generic body, vectorized by the compiler
+    __attribute__((target("avx2")))
+    inline void kernelAvx2(const size_t k, const int32_t* a, const int32_t* b, int32_t* tile) {
+        genericKernelBody<int32_t, 6, 16>(k, a, b, tile);
+    }
+
+    __attribute__((target("avx2")))
+    inline void kernelAvx2(const size_t k, const int64_t* a, const int64_t* b, int64_t* tile) {
+        genericKernelBody<int64_t, 6, 8>(k, a, b, tile);
+    }
+
+    __attribute__((target("avx512f")))
+    inline void kernelAvx512(const size_t k, const int32_t* a, const int32_t* b, int32_t* tile) {
+        genericKernelBody<int32_t, 6, 32>(k, a, b, tile);
+    }
+
+    __attribute__((target("avx512f,avx512dq")))
+    inline void kernelAvx512(const size_t k, const int64_t* a, const int64_t* b, int64_t* tile) {
+        genericKernelBody<int64_t, 6, 16>(k, a, b, tile);
+    }
+#endif
+
+    template<typename T>
+    struct HasSimdKernel : std::integral_constant<bool,
+        std::is_same<T, float>::value || std::is_same<T, double>::value ||
+        std::is_same<T, int32_t>::value || std::is_same<T, int64_t>::value> { };
+
+    // picked once per element type on first use
+    template<typename T>
+    const KernelChoice<T>& kernelChoice() {
+        static const KernelChoice<T> choice = []() -> KernelChoice<T> {
+#ifdef GEMM_X86_DISPATCH
+            if constexpr (HasSimdKernel<T>::value) {
+                __builtin_cpu_init();
+                const bool needsDq = std::is_same<T, int64_t>::value;
+                if (__builtin_cpu_supports("avx512f") && (!needsDq || __builtin_cpu_supports("avx512dq"))) {
+                    return {&kernelAvx512, 6, 64 / sizeof(T) * 2};
+                }
+                if (__builtin_cpu_supports("avx2") &&
+                    (std::is_integral<T>::value || __builtin_cpu_supports("fma"))) {
+                    return {&kernelAvx2, 6, 32 / sizeof(T) * 2};
+                }
+            }
+#endif
+            return {&genericKernel<T, 4, 4>, 4, 4};
+        }();
+        return choice;
+    }
+
+    // slice sizes: a KC x NR panel of 'b' stays in L1, an MC x KC slice
+    // of 'a' in L2 and a KC x NC slice of 'b' in L3
+    constexpr size_t KC = 256;
+    constexpr size_t MC = 120;
+    constexpr size_t NC = 2048;
+    // products with fewer multiply-adds than this skip the packing
+    constexpr size_t SMALL = 1 << 15;
+
+    template<typename T>
+    using Buffer = std::vector<T, AlignedAllocator<T>>;
+
+    // rows [row, row + rows) x [depth, depth + depthSize) of 'a' as MR-row panels
+    template<typename T>
+    void packA(const MatrixView<const T>& a, const size_t row, const size_t rows,
+               const size_t depth, const size_t depthSize, const size_t mr, T* target) {
+        for (size_t panel = 0; panel < rows; panel += mr) {
+            const size_t height = std::min(mr, rows - panel);
+            for (size_t p = 0; p < depthSize; ++p) {
+                for (size_t i = 0; i < height; ++i) {
+                    target[i] = a(row + panel + i, depth + p);
+                }
+                std::fill(target + height, target + mr, T(0));
+                target += mr;
+            }
+        }
+    }
+
+    // [depth, depth + depthSize) x columns [column, column + columns) of 'b' as NR-column panels
+    template<typename T>
+    void packB(const MatrixView<const T>& b, const size_t depth, const size_t depthSize,
+               const size_t column, const size_t columns, const size_t nr, T* target) {
+        for (size_t panel = 0; panel < columns; panel += nr) {
+            const size_t width = std::min(nr, columns - panel);
+            for (size_t p = 0; p < depthSize; ++p) {
+                if (b.isRowContiguous()) {
+                    const T* source = &b(depth + p, column + panel);
+                    std::copy(source, source + width, target);
+                } else {
+                    for (size_t j = 0; j < width; ++j) {
+                        target[j] = b(depth + p, column + panel + j);
+                    }
+                }
+                std::fill(target + width, target + nr, T(0));
+                target += nr;
+            }
+        }
+    }
+
+    // c += a * b over rows [fromRow, toRow) of 'c', sizes are not checked.
+    // separate row ranges can run on separate threads
+    template<typename T>
+    void multiplyRows(const MatrixView<const T>& a, const MatrixView<const T>& b,
+                      const MatrixView<T>& c, const size_t fromRow, const size_t toRow) {
+        const size_t m = toRow - fromRow;
+        const size_t n = c.columnsSize();
+        const size_t k = a.columnsSize();
+        if (m == 0 || n == 0 || k == 0) {
+            return;
+        }
+        if (m * n * k < SMALL) {
+            for (size_t i = fromRow; i < toRow; ++i) {
+                for (size_t p = 0; p < k; ++p) {
+                    const T value = a(i, p);
+                    for (size_t j = 0; j < n; ++j) {
+                        c(i, j) += value * b(p, j);
+                    }
+                }
+            }
+            return;
+        }
+        const KernelChoice<T>& choice = kernelChoice<T>();
+        const size_t mr = choice.mr;
+        const size_t nr = choice.nr;
+        const size_t mc = MC / mr * mr;
+        const size_t nc = NC / nr * nr;
+        // per thread and only ever grown, repeated products allocate nothing
+        static thread_local Buffer<T> packedA;
+        static thread_local Buffer<T> packedB;
+        static thread_local Buffer<T> tile;
+        packedA.resize(std::max(packedA.size(), (mc + mr) * KC));
+        packedB.resize(std::max(packedB.size(), (nc + nr) * KC));
+        tile.resize(std::max(tile.size(), mr * nr));
+        for (size_t jc = 0; jc < n; jc += nc) {
+            const size_t columns = std::min(nc, n - jc);
+            for (size_t pc = 0; pc < k; pc += KC) {
+                const size_t depth = std::min(KC, k - pc);
+                packB(b, pc, depth, jc, columns, nr, packedB.data());
+                for (size_t ic = fromRow; ic < toRow; ic += mc) {
+                    const size_t rows = std::min(mc, toRow - ic);
+                    packA(a, ic, rows, pc, depth, mr, packedA.data());
+                    for (size_t jr = 0; jr < columns; jr += nr) {
+                        const size_t width = std::min(nr, columns - jr);
+                        for (size_t ir = 0; ir < rows; ir += mr) {
+                            const size_t height = std::min(mr, rows - ir);
+                            choice.kernel(depth, packedA.data() + ir * depth,
+                                          packedB.data() + jr * depth, tile.data());
+                            for (size_t i = 0; i < height; ++i) {
+                                for (size_t j = 0; j < width; ++j) {
+                                    c(ic + ir + i, jc + jr + j) += tile[i * nr + j];
+                                }
+                            }
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    // keeps 'T' of the operands out of deduction, so mutable views convert
+    template<typename T>
+    struct Identity {
+        using type = T;
+    };
+
+    // c += a * b
+    template<typename T>
+    void multiply(const MatrixView<const typename Identity<T>::type>& a,
+                  const MatrixView<const typename Identity<T>::type>& b, const MatrixView<T>& c) {
+        if (a.columnsSize() != b.rowsSize() ||
+            a.rowsSize() != c.rowsSize() || b.columnsSize() != c.columnsSize()) {
+            throw std::logic_error("sizes mismatch");
+        }
+        multiplyRows(a, b, c, 0, c.rowsSize());
+    }
+}
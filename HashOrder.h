@@ -0,0 +1,10 @@
+#pragma once
+#include <functional>
+
+// default order of Treap and PersistentTreap: by std::hash, so equal hashes are equal keys
+template<typename T>
+struct HashOrder {
+    bool operator()(const T& first, const T& second) const {
+        return std::hash<T>{}(first) < std::hash<T>{}(second);
+    }
+};
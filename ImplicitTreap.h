@@ -0,0 +1,340 @@
+#pragma once
+#include <ctime>
+#include <random>
+#include <memory>
+#include <vector>
+#include <cstdint>
+#include <stdexcept>
+#include <algorithm>
+#include "TreapNodePool.h"
+
+/* Sequence indexed by position (implicit-key treap, rope).
+   Every edit is O(log n): the range is cut out with two splits, changed
+   through a lazy tag on its root and merged back. Tags are pushed down to
+   the children whenever split or merge descends through a node.
+   Ranges are inclusive: [from, to].
+
+   ImplicitTreap<int64_t> rope;
+   rope.pushBack(1); rope.pushBack(2); rope.pushBack(3);  // 1 2 3
+   rope.insertAt(1, 5);                                   // 1 5 2 3
+   rope.reverseRange(0, 2);                               // 2 5 1 3
+   rope.addRange(1, 3, 10);                               // 2 15 11 13
+   int64_t sum = rope.sumRange(0, 1);                     // 17
+ */
+template<typename T, typename Allocator = std::allocator<T>>
+class ImplicitTreap {
+public:
+    ImplicitTreap() : rnd(time(nullptr)) {}
+    ImplicitTreap(const ImplicitTreap& other) = delete;
+    ImplicitTreap(ImplicitTreap&& other) :
+        rnd(time(nullptr)),
+        nodes(std::move(other.nodes)),
+        root(other.root) {
+        other.root = NONE;
+    }
+
+    // inserts 'value' so that it ends up at 'position'
+    void insertAt(size_t position, const T& value) {
+        if (position > size()) {
+            throw std::out_of_range("index out of range");
+        }
+        auto parts = split(root, position);
+        root = merge(merge(parts.first, allocate(value)), parts.second);
+    }
+
+    void pushBack(const T& value) {
+        root = merge(root, allocate(value));
+    }
+
+    void eraseAt(size_t position) {
+        eraseRange(position, position);
+    }
+
+    void eraseRange(size_t from, size_t to) {
+        Range range = cut(from, to);
+        nodes.release(range.middle);
+        range.middle = NONE;
+        paste(range);
+    }
+
+    void reverseRange(size_t from, size_t to) {
+        Range range = cut(from, to);
+        nodes[range.middle].reversed ^= true;
+        paste(range);
+    }
+
+    void addRange(size_t from, size_t to, const T& delta) {
+        Range range = cut(from, to);
+        apply(range.middle, delta);
+        paste(range);
+    }
+
+    T sumRange(size_t from, size_t to) {
+        Range range = cut(from, to);
+        const T result = nodes[range.middle].sum;
+        paste(range);
+        return result;
+    }
+
+    T minRange(size_t from, size_t to) {
+        Range range = cut(from, to);
+        const T result = nodes[range.middle].minimum;
+        paste(range);
+        return result;
+    }
+
+    T maxRange(size_t from, size_t to) {
+        Range range = cut(from, to);
+        const T result = nodes[range.middle].maximum;
+        paste(range);
+        return result;
+    }
+
+    // reads the element without pushing tags, pending ones are summed on the way
+    T at(size_t position) const {
+        if (position >= size()) {
+            throw std::out_of_range("index out of range");
+        }
+        uint32_t node = root;
+        T pending = T();
+        bool reversed = false;
+        while (true) {
+            reversed ^= nodes[node].reversed;
+            const uint32_t left = reversed ? nodes[node].right : nodes[node].left;
+            const uint32_t right = reversed ? nodes[node].left : nodes[node].right;
+            const size_t leftCount = getCount(left);
+            if (position == leftCount) {
+                return nodes[node].value + pending;
+            }
+            pending += nodes[node].add;
+            if (position < leftCount) {
+                node = left;
+            } else {
+                position -= leftCount + 1;
+                node = right;
+            }
+        }
+    }
+
+    size_t size() const {
+        return getCount(root);
+    }
+
+    void reserve(size_t count) {
+        nodes.reserve(count);
+    }
+
+    void clear() {
+        nodes.clear();
+        root = NONE;
+    }
+
+    std::vector<T> toVector() const {
+        std::vector<T> result;
+        result.reserve(size());
+        // nodes with the tags accumulated from their ancestors
+        struct Frame {
+            uint32_t node;
+            T pending;
+            bool reversed;
+            bool expanded;
+        };
+        std::vector<Frame> stack;
+        if (root != NONE) {
+            stack.push_back({root, T(), false, false});
+        }
+        while (!stack.empty()) {
+            Frame frame = stack.back();
+            stack.pop_back();
+            const Node& node = nodes[frame.node];
+            if (frame.expanded) {
+                result.push_back(node.value + frame.pending);
+                continue;
+            }
+            const bool reversed = frame.reversed ^ node.reversed;
+            const T pending = frame.pending + node.add;
+            const uint32_t left = reversed ? node.right : node.left;
+            const uint32_t right = reversed ? node.left : node.right;
+            if (right != NONE) {
+                stack.push_back({right, pending, reversed, false});
+            }
+            stack.push_back({frame.node, frame.pending, reversed, true});
+            if (left != NONE) {
+                stack.push_back({left, pending, reversed, false});
+            }
+        }
+        return result;
+    }
+
+    ImplicitTreap& operator=(const ImplicitTreap& other) = delete;
+
+    ImplicitTreap& operator=(ImplicitTreap&& other) {
+        nodes = std::move(other.nodes);
+        root = other.root;
+        other.root = NONE;
+        return *this;
+    }
+private:
+    static constexpr uint32_t NONE = UINT32_MAX;
+
+    std::mt19937 rnd;
+
+    // value, sum, minimum and maximum already include 'add';
+    // 'add' and 'reversed' are still to be applied to the children
+    struct Node {
+        T value;
+        T sum;
+        T minimum;
+        T maximum;
+        T add;
+        bool reversed;
+        uint32_t priority;
+        uint32_t count;
+        uint32_t left;
+        // next free node while the node is on the free list
+        uint32_t right;
+    };
+
+    // [0, from), [from, to], (to, size)
+    struct Range {
+        uint32_t left;
+        uint32_t middle;
+        uint32_t right;
+    };
+
+    TreapNodePool<Node, Allocator> nodes;
+    uint32_t root = NONE;
+    // scratch stack of visited nodes, kept to avoid reallocating on every operation
+    std::vector<uint32_t> path;
+
+    uint32_t allocate(const T& value) {
+        return nodes.allocate({value, value, value, value, T(), false,
+                               static_cast<uint32_t>(rnd()), 1, NONE, NONE});
+    }
+
+    Range cut(size_t from, size_t to) {
+        if (from > to || to >= size()) {
+            throw std::out_of_range("index out of range");
+        }
+        auto first = split(root, from);
+        auto second = split(first.second, to - from + 1);
+        return {first.first, second.first, second.second};
+    }
+
+    void paste(const Range& range) {
+        root = merge(merge(range.left, range.middle), range.right);
+    }
+
+    uint32_t getCount(uint32_t node) const {
+        return node != NONE ? nodes[node].count : 0;
+    }
+
+    void apply(uint32_t node, const T& delta) {
+        Node& current = nodes[node];
+        current.value += delta;
+        current.sum += delta * static_cast<T>(current.count);
+        current.minimum += delta;
+        current.maximum += delta;
+        current.add += delta;
+    }
+
+    // hands the node's tags down to its children
+    void push(uint32_t node) {
+        Node& current = nodes[node];
+        if (current.reversed) {
+            std::swap(current.left, current.right);
+            for (uint32_t child : {current.left, current.right}) {
+                if (child != NONE) {
+                    nodes[child].reversed ^= true;
+                }
+            }
+            current.reversed = false;
+        }
+        if (current.add != T()) {
+            for (uint32_t child : {current.left, current.right}) {
+                if (child != NONE) {
+                    apply(child, current.add);
+                }
+            }
+            current.add = T();
+        }
+    }
+
+    // recomputes count and aggregates from the children
+    void pull(uint32_t node) {
+        Node& current = nodes[node];
+        current.count = 1;
+        current.sum = current.value;
+        current.minimum = current.value;
+        current.maximum = current.value;
+        for (uint32_t child : {current.left, current.right}) {
+            if (child != NONE) {
+                current.count += nodes[child].count;
+                current.sum += nodes[child].sum;
+                current.minimum = std::min(current.minimum, nodes[child].minimum);
+                current.maximum = std::max(current.maximum, nodes[child].maximum);
+            }
+        }
+    }
+
+    // recomputes the nodes on 'path', deepest first
+    void updatePath() {
+        for (auto it = path.rbegin(); it != path.rend(); ++it) {
+            pull(*it);
+        }
+    }
+
+    // top-down: the node with the higher priority is hooked into the result
+    // and the merge continues in its inner subtree
+    uint32_t merge(uint32_t left, uint32_t right) {
+        uint32_t result = NONE;
+        uint32_t* hook = &result;
+        path.clear();
+        while (left != NONE && right != NONE) {
+            if (nodes[left].priority > nodes[right].priority) {
+                push(left);
+                *hook = left;
+                path.push_back(left);
+                hook = &nodes[left].right;
+                left = nodes[left].right;
+            } else {
+                push(right);
+                *hook = right;
+                path.push_back(right);
+                hook = &nodes[right].left;
+                right = nodes[right].left;
+            }
+        }
+        *hook = left != NONE ? left : right;
+        updatePath();
+        return result;
+    }
+
+    // left part gets the first 'count' elements
+    std::pair<uint32_t, uint32_t> split(uint32_t node, size_t count) {
+        uint32_t left = NONE;
+        uint32_t right = NONE;
+        uint32_t* leftHook = &left;
+        uint32_t* rightHook = &right;
+        path.clear();
+        while (node != NONE) {
+            push(node);
+            path.push_back(node);
+            const size_t leftCount = getCount(nodes[node].left);
+            if (count > leftCount) {
+                count -= leftCount + 1;
+                *leftHook = node;
+                leftHook = &nodes[node].right;
+                node = nodes[node].right;
+            } else {
+                *rightHook = node;
+                rightHook = &nodes[node].left;
+                node = nodes[node].left;
+            }
+        }
+        *leftHook = NONE;
+        *rightHook = NONE;
+        updatePath();
+        return {left, right};
+    }
+};
@@ -3,18 +3,47 @@
 #include <vector>
 #include <iostream>
 #include <cmath>
+#include <stdexcept>
+#include <atomic>
+#include <algorithm>
+#include <type_traits>
+#include "AlignedAllocator.h"
+#include "MatrixView.h"
+#include "Gemm.h"
+#include "ThreadPool.h"
+#include "MatrixExpression.h"
+#include "Semiring.h"
+
+// Elements live in one cache-line aligned row-major buffer,
+// (i, j) is at i * columns + j. at() is bounds checked, operator() is not.
+// Products and element-wise operations run on ThreadPool::shared(): resize
+// it to change the number of threads, setParallelGrain() sets how many
+// elements an element-wise task gets at least.
+// +, - and scalar * build lazy expressions, see MatrixExpression.h.
+
+// least number of elements per task of the element-wise operations,
+// one setting for every element type
+inline std::atomic<size_t> matrixParallelGrain{1 << 15};
 
 template<typename T>
-class Matrix2D {
+class Matrix2D : public MatrixExpressionTag {
 public:
+    using value_type = T;
+
+    // expressions other than Matrix2D itself, which has its own copy and move
+    template<typename E>
+    using EnableExpression = std::enable_if_t<IsMatrixExpression<E>::value &&
+                                              !std::is_same<std::decay_t<E>, Matrix2D>::value>;
+
     Matrix2D() { }
     Matrix2D(size_t x, size_t y) :
-        matrix(std::vector<std::vector<T>>(x, std::vector<T>(y, 0))) { }
+        rows(x),
+        columns(y),
+        elements(x * y, T(0)) { }
 
-    explicit Matrix2D(size_t n) {
-        matrix.resize(n, std::vector<T>(n, 0));
+    explicit Matrix2D(size_t n) : Matrix2D(n, n) {
         for(size_t i = 0; i < n; i++) {
-            matrix[i][i] = 1;
+            (*this)(i, i) = 1;
         }
     }
 
@@ -22,31 +51,109 @@ public:
         if(vector.size() == 0 || vector.at(0).size() == 0){
             throw std::invalid_argument("invalid parameters");
         }
-        matrix = vector;
+        rows = vector.size();
+        columns = vector[0].size();
+        elements.reserve(rows * columns);
+        for (const std::vector<T>& row : vector) {
+            if (row.size() != columns) {
+                throw std::invalid_argument("invalid parameters");
+            }
+            elements.insert(elements.end(), row.begin(), row.end());
+        }
     }
 
-    Matrix2D(const Matrix2D& other) : matrix(other.matrix) { }
-    Matrix2D(Matrix2D&& other) : matrix(std::move(other.matrix)) { }
+    // copies the elements a view points to
+    explicit Matrix2D(const MatrixView<const T>& view) : Matrix2D(view.rowsSize(), view.columnsSize()) {
+        for (size_t i = 0; i < rows; i++) {
+            for (size_t j = 0; j < columns; j++) {
+                (*this)(i, j) = view(i, j);
+            }
+        }
+    }
+
+    Matrix2D(const Matrix2D& other) :
+        rows(other.rows),
+        columns(other.columns),
+        elements(other.elements) { }
+
+    Matrix2D(Matrix2D&& other) :
+        rows(other.rows),
+        columns(other.columns),
+        elements(std::move(other.elements)) {
+        other.rows = 0;
+        other.columns = 0;
+    }
+
+    // evaluates an element-wise expression in one pass
+    template<typename E, typename = EnableExpression<E>>
+    Matrix2D(E&& expression) {
+        assign(std::forward<E>(expression));
+    }
 
     const T& at(size_t x, size_t y) const {
-        return matrix.at(x).at(y);
+        check(x, y);
+        return elements[x * columns + y];
     }
 
     T& at(size_t x, size_t y) {
-        return matrix.at(x).at(y);
+        check(x, y);
+        return elements[x * columns + y];
+    }
+
+    // unchecked access for hot loops
+    const T& operator()(size_t x, size_t y) const {
+        return elements[x * columns + y];
+    }
+
+    T& operator()(size_t x, size_t y) {
+        return elements[x * columns + y];
+    }
+
+    // element by its index in the row-major buffer, for expressions
+    const T& element(size_t index) const {
+        return elements[index];
+    }
+
+    const T* data() const {
+        return elements.data();
+    }
+
+    T* data() {
+        return elements.data();
+    }
+
+    MatrixView<const T> view() const {
+        return MatrixView<const T>(elements.data(), rows, columns, columns);
+    }
+
+    MatrixView<T> view() {
+        return MatrixView<T>(elements.data(), rows, columns, columns);
     }
 
     void clear() {
-        matrix.clear();
+        elements.clear();
+        rows = 0;
+        columns = 0;
     }
 
+    // keeps the overlapping elements, new ones are value-initialized
     void resize(size_t x, size_t y) {
-        matrix.resize(x, std::vector<T>(y));
+        if (y == columns) {
+            elements.resize(x * y);
+        } else {
+            Storage resized(x * y);
+            for (size_t i = 0; i < std::min(x, rows); i++) {
+                std::copy_n(elements.begin() + i * columns, std::min(y, columns),
+                            resized.begin() + i * y);
+            }
+            elements.swap(resized);
+        }
+        rows = x;
+        columns = y;
     }
 
     std::pair<size_t, size_t> size() const {
-        size_t y = matrix.size() == 0 ? 0 : matrix.at(0).size();
-        return {matrix.size(), y};
+        return {rows, columns};
     }
 
     Matrix2D operator*(const Matrix2D& other) const {
@@ -56,61 +163,118 @@ public:
             throw std::logic_error("sizes mismatch");
         }
         Matrix2D result(thisSize.x, otherSize.y);
-        for (size_t i = 0; i < thisSize.x; i++) {
-            for (size_t j = 0; j < otherSize.y; j++) {
-                for (size_t k = 0; k < otherSize.x; k++) {
-                    result.at(i, j) += (at(i, k) * other.at(k, j));
-                }
-            }
-        }
+        multiplyInto(other, result);
         return result;
     }
 
-    Matrix2D operator+(const Matrix2D& other) const {
+    Matrix2D& operator=(const Matrix2D& other) {
+        rows = other.rows;
+        columns = other.columns;
+        elements = other.elements;
+        return *this;
+    }
+
+    Matrix2D& operator=(Matrix2D&& other) {
+        rows = other.rows;
+        columns = other.columns;
+        elements = std::move(other.elements);
+        other.rows = 0;
+        other.columns = 0;
+        return *this;
+    }
+
+    // reuses the buffer when the sizes match
+    template<typename E, typename = EnableExpression<E>>
+    Matrix2D& operator=(E&& expression) {
+        assign(std::forward<E>(expression));
+        return *this;
+    }
+
+    template<typename E, typename = std::enable_if_t<IsMatrixExpression<E>::value>>
+    Matrix2D& operator+=(const E& expression) {
+        checkSize(expression.size());
+        T* target = elements.data();
+        forEachElement(expression, [=](size_t i, const T& value) {
+            target[i] += value;
+        });
+        return *this;
+    }
+
+    template<typename E, typename = std::enable_if_t<IsMatrixExpression<E>::value>>
+    Matrix2D& operator-=(const E& expression) {
+        checkSize(expression.size());
+        T* target = elements.data();
+        forEachElement(expression, [=](size_t i, const T& value) {
+            target[i] -= value;
+        });
+        return *this;
+    }
+
+    Matrix2D& operator*=(const T& value) {
+        if (rows == 0 || columns == 0) {
+            throw std::logic_error("cannot multiply zero matrix");
+        }
+        T* target = elements.data();
+        forEachIndex(elements.size(), [=](size_t from, size_t to) {
+            for (size_t i = from; i < to; i++) {
+                target[i] *= value;
+            }
+        });
+        return *this;
+    }
+
+    Matrix2D& operator*=(const Matrix2D& other) {
+        *this = *this * other;
+        return *this;
+    }
+
+    // least number of elements per task of the element-wise operations,
+    // shared by all Matrix2D<T>
+    static void setParallelGrain(size_t elements) {
+        matrixParallelGrain.store(std::max<size_t>(elements, 1), std::memory_order_relaxed);
+    }
+
+    // product over a semiring from Semiring.h, e.g. min-plus or modular
+    template<typename Semiring>
+    Matrix2D multiply(const Matrix2D& other, const Semiring& semiring) const {
         Size thisSize = (Size)size();
         Size otherSize = (Size)other.size();
-        if (thisSize != otherSize) {
+        if (thisSize.y != otherSize.x) {
             throw std::logic_error("sizes mismatch");
         }
         Matrix2D result(thisSize.x, otherSize.y);
-        for (size_t i = 0; i < thisSize.x; i++) {
-            for (size_t j = 0; j < otherSize.y; j++) {
-                result.at(i, j) = at(i, j) + other.at(i, j);
-            }
-        }
+        semiringMultiply(semiring, view(), other.view(), result.view());
         return result;
     }
 
-    Matrix2D operator-(const Matrix2D& other) const {
+    // n-th power over a semiring, the identity holds one() on the diagonal
+    template<typename Semiring>
+    Matrix2D pow(size_t n, const Semiring& semiring) const {
         Size thisSize = (Size)size();
-        Size otherSize = (Size)other.size();
-        if (thisSize != otherSize) {
+        if(thisSize.x != thisSize.y) {
             throw std::logic_error("sizes mismatch");
         }
-        Matrix2D result(thisSize.x, otherSize.y);
-        for (size_t i = 0; i < thisSize.x; i++) {
-            for (size_t j = 0; j < otherSize.y; j++) {
-                result.at(i, j) = at(i, j) - other.at(i, j);
+        Matrix2D result(thisSize.x, thisSize.y);
+        std::fill(result.elements.begin(), result.elements.end(), semiring.zero());
+        for(size_t i = 0; i < thisSize.x; i++) {
+            result(i, i) = semiring.one();
+        }
+        Matrix2D temp(*this);
+        Matrix2D scratch(thisSize.x, thisSize.y);
+        while(n) {
+            if (n & 1) {
+                semiringMultiply(semiring, result.view(), temp.view(), scratch.view());
+                result.elements.swap(scratch.elements);
+            }
+            n >>= 1;
+            if (n) {
+                semiringMultiply(semiring, temp.view(), temp.view(), scratch.view());
+                temp.elements.swap(scratch.elements);
             }
         }
         return result;
     }
 
-    template<typename U>
-    friend Matrix2D<U> operator*(const Matrix2D<U>& lhs, const U& rhs);
-    template<typename U>
-    friend Matrix2D<U> operator*(const U& lhs, const Matrix2D<U>& rhs);
-
-    Matrix2D& operator=(const Matrix2D& other) {
-        matrix = other.matrix;
-        return *this;
-    }
-
-    Matrix2D& operator=(Matrix2D&& other) {
-        matrix = move(other.matrix);
-        return *this;
-    }
-
     Matrix2D pow(size_t n) const {
         Size thisSize = (Size)size();
         if(thisSize.x != thisSize.y) {
@@ -118,17 +282,29 @@ public:
         }
         Matrix2D result(thisSize.x);
         Matrix2D temp(*this);
+        // every product goes to 'scratch', which then swaps buffers with
+        // its target, so the loop allocates no matrices
+        Matrix2D scratch(thisSize.x, thisSize.y);
         while(n) {
-            if (n & 1)
-                result = result * temp;
-            temp = temp * temp;
+            if (n & 1) {
+                result.productTo(temp, scratch);
+                result.elements.swap(scratch.elements);
+            }
             n >>= 1;
+            if (n) {
+                temp.productTo(temp, scratch);
+                temp.elements.swap(scratch.elements);
+            }
         }
         return result;
     }
 
 private:
-    std::vector<std::vector<T>> matrix;
+    using Storage = std::vector<T, AlignedAllocator<T>>;
+
+    size_t rows = 0;
+    size_t columns = 0;
+    Storage elements;
 
     class Size {
     public:
@@ -151,41 +327,129 @@ private:
         }
     };
 
-    Matrix2D multiplyByValue(const T& other) const {
-        Size thisSize = (Size)size();
-        if (thisSize.x == 0 || thisSize.y == 0) {
-            throw std::logic_error("cannot multiply zero matrix");
+    // runs function(from, to) over [0, count) in parallel chunks
+    template<typename Function>
+    static void forEachIndex(size_t count, Function function) {
+        ThreadPool::shared().parallelFor(0, count, matrixParallelGrain.load(std::memory_order_relaxed), function);
+    }
+
+    // a moved-in matrix inside the expression lends its buffer, otherwise
+    // the own buffer is reused when the sizes match. element i only reads
+    // index i of every operand, so writing over an operand is safe
+    template<typename E>
+    void assign(E&& expression) {
+        const std::pair<size_t, size_t> target = expression.size();
+        Matrix2D* owned = nullptr;
+        if constexpr (!std::is_lvalue_reference<E>::value) {
+            owned = expression.owned();
         }
-        Matrix2D result(thisSize.x, thisSize.y);
-        for (size_t i = 0; i < thisSize.x; i++) {
-            for (size_t j = 0; j < thisSize.y; j++) {
-                result.at(i, j) = at(i, j) * other;
+        if (owned != nullptr && owned != this) {
+            owned->evaluate(expression);
+            *this = std::move(*owned);
+        } else if (size() == target) {
+            evaluate(expression);
+        } else {
+            Matrix2D result(target.first, target.second);
+            result.evaluate(expression);
+            *this = std::move(result);
+        }
+    }
+
+    template<typename E>
+    void evaluate(const E& expression) {
+        T* target = elements.data();
+        forEachElement(expression, [=](size_t i, const T& value) {
+            target[i] = value;
+        });
+    }
+
+    // store(i, element i of 'expression') for every element, in parallel.
+    // the check for written nodes runs once, not per element
+    template<typename E, typename Store>
+    void forEachElement(const E& expression, Store store) const {
+        if (writtenOperand<T>(expression)) {
+            forEachIndex(elements.size(), [&](size_t from, size_t to) {
+                for (size_t i = from; i < to; i++) {
+                    store(i, expression.element(i));
+                }
+            });
+        } else {
+            forEachIndex(elements.size(), [&](size_t from, size_t to) {
+                for (size_t i = from; i < to; i++) {
+                    store(i, operandElement<T, true>(expression, i));
+                }
+            });
+        }
+    }
+
+    // target = *this * other, in the buffer of 'target'
+    void productTo(const Matrix2D& other, Matrix2D& target) const {
+        std::fill(target.elements.begin(), target.elements.end(), T(0));
+        multiplyInto(other, target);
+    }
+
+    // result += *this * other, split into MC x NC output tiles of Gemm
+    void multiplyInto(const Matrix2D& other, Matrix2D& result) const {
+        const size_t rowTiles = (rows + Gemm::MC - 1) / Gemm::MC;
+        const size_t columnTiles = (other.columns + Gemm::NC - 1) / Gemm::NC;
+        if (rows * columns * other.columns < Gemm::SMALL * ThreadPool::shared().size()) {
+            Gemm::multiply(view(), other.view(), result.view());
+            return;
+        }
+        ThreadPool::shared().parallelFor(0, rowTiles * columnTiles, 1, [&](size_t from, size_t to) {
+            for (size_t tile = from; tile < to; tile++) {
+                const size_t row = tile / columnTiles * Gemm::MC;
+                const size_t column = tile % columnTiles * Gemm::NC;
+                const size_t width = std::min(Gemm::NC, other.columns - column);
+                Gemm::multiplyRows(view(), other.view().submatrix(0, column, other.rows, width),
+                                   result.view().submatrix(0, column, rows, width),
+                                   row, std::min(rows, row + Gemm::MC));
             }
+        });
+    }
+
+    void check(size_t x, size_t y) const {
+        if (x >= rows || y >= columns) {
+            throw std::out_of_range("index out of range");
+        }
+    }
+
+    void checkSize(const std::pair<size_t, size_t>& other) const {
+        if (size() != other) {
+            throw std::logic_error("sizes mismatch");
         }
-        return result;
     }
 };
 
-template <typename U>
-Matrix2D<U> operator*(const Matrix2D<U> &lhs, const U& rhs) {
-    return lhs.multiplyByValue(rhs);
+// matrix product with an expression operand: the expression is evaluated first
+template<typename T, typename E>
+decltype(auto) evaluated(E&& expression) {
+    if constexpr (std::is_same<std::decay_t<E>, Matrix2D<T>>::value) {
+        return std::forward<E>(expression);
+    } else {
+        return Matrix2D<T>(std::forward<E>(expression));
+    }
 }
 
-template<typename U>
-Matrix2D<U> operator*(const U& lhs, const Matrix2D<U> &rhs) {
-    return rhs.multiplyByValue(lhs);
+template<typename L, typename R, typename = std::enable_if_t<
+    IsMatrixExpression<L>::value && IsMatrixExpression<R>::value &&
+    !(std::is_same<std::decay_t<L>, Matrix2D<typename std::decay_t<L>::value_type>>::value &&
+      std::is_same<std::decay_t<R>, Matrix2D<typename std::decay_t<R>::value_type>>::value)>>
+auto operator*(L&& left, R&& right) {
+    using T = typename std::decay_t<L>::value_type;
+    return evaluated<T>(std::forward<L>(left)) * evaluated<T>(std::forward<R>(right));
 }
 
 
 template<typename T>
 std::ostream& operator<<(std::ostream& out, const Matrix2D<T>& m){
     out << '[';
-    for(int i = 0; i < m.size().first; i++){
+    for(size_t i = 0; i < m.size().first; i++){
         if(i != 0){
             out << '\n';
         }
         out << '[';
-        for(int j = 0; j < m.size().second; j++){
+        for(size_t j = 0; j < m.size().second; j++){
             if(j != 0){
                 out << ", ";
             }
@@ -197,3 +461,10 @@ std::ostream& operator<<(std::ostream& out, const Matrix2D<T>& m){
     return out;
 }
 
+// an expression prints as the matrix it evaluates to
+template<typename E, typename = std::enable_if_t<
+    IsMatrixExpression<E>::value && !std::is_same<E, Matrix2D<typename E::value_type>>::value>>
+std::ostream& operator<<(std::ostream& out, const E& expression) {
+    return out << expression.eval();
+}
+
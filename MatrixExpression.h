@@ -0,0 +1,272 @@
+#pragma once
+#include <memory>
+#include <cstddef>
+#include <utility>
+#include <stdexcept>
+#include <functional>
+#include <type_traits>
+
+/* Lazy element-wise expressions over Matrix2D. 'a * 2 + b - c' builds a
+   small tree of nodes and no matrix; assigning it to a Matrix2D evaluates
+   every element once, in one pass over one buffer.
+   A node keeps lvalue operands by reference and rvalue operands by value,
+   so temporaries inside the chain live as long as the node. A node owning
+   a Matrix2D that was moved in hands its buffer over to the result:
+   'std::move(a) + b' writes into the memory of 'a'.
+   A node still reads like a matrix: (i, j) and at() compute one element,
+   eval() returns the Matrix2D, and pow() and << evaluate first. Writing
+   through a non-const node's (i, j) or at() evaluates it once into a matrix
+   the node owns, and every later read comes from that matrix.
+
+   Matrix2D<int> d = a * 2 + b - c;
+   d += a - b;
+   std::cout << (a + b) << (a - b).pow(3);
+ */
+template<typename T>
+class Matrix2D;
+
+// base of Matrix2D and every expression node
+struct MatrixExpressionTag { };
+
+// what every node shares: element reads straight from the node, evaluation
+// into a Matrix2D, and the matrix a node turns into once it is written to.
+// 'Derived' provides compute<Fresh>(index), operandsWritten(), size() and
+// ownedOperand()
+template<typename T, typename Derived>
+class MatrixExpressionNode : public MatrixExpressionTag {
+public:
+    MatrixExpressionNode() = default;
+
+    MatrixExpressionNode(const MatrixExpressionNode& other) :
+        cache(other.cache ? std::make_unique<Matrix2D<T>>(*other.cache) : nullptr) { }
+
+    MatrixExpressionNode(MatrixExpressionNode&& other) = default;
+
+    MatrixExpressionNode& operator=(const MatrixExpressionNode& other) {
+        cache = other.cache ? std::make_unique<Matrix2D<T>>(*other.cache) : nullptr;
+        return *this;
+    }
+
+    MatrixExpressionNode& operator=(MatrixExpressionNode&& other) = default;
+
+    T element(const size_t index) const {
+        return cache ? cache->element(index) : self().template compute<false>(index);
+    }
+
+    // element 'index' ignoring the matrices of written nodes, so evaluation
+    // loops test for them once instead of per element; only valid while
+    // written() is false
+    T fresh(const size_t index) const {
+        return self().template compute<true>(index);
+    }
+
+    // whether this node or one below it was written to
+    bool written() const {
+        return cache != nullptr || self().operandsWritten();
+    }
+
+    T operator()(const size_t x, const size_t y) const {
+        return element(x * self().size().second + y);
+    }
+
+    T at(const size_t x, const size_t y) const {
+        check(x, y);
+        return (*this)(x, y);
+    }
+
+    // writable access evaluates the node into its own matrix first
+    T& operator()(const size_t x, const size_t y) {
+        return materialize()(x, y);
+    }
+
+    T& at(const size_t x, const size_t y) {
+        check(x, y);
+        return materialize()(x, y);
+    }
+
+    Matrix2D<T> eval() const {
+        return cache ? *cache : Matrix2D<T>(self());
+    }
+
+    Matrix2D<T> pow(const size_t n) const {
+        return eval().pow(n);
+    }
+
+    template<typename Semiring>
+    Matrix2D<T> pow(const size_t n, const Semiring& semiring) const {
+        return eval().pow(n, semiring);
+    }
+
+    // a written node hands over its own matrix, an untouched one
+    // the first Matrix2D it got by value
+    Matrix2D<T>* owned() {
+        return cache ? cache.get() : static_cast<Derived&>(*this).ownedOperand();
+    }
+
+private:
+    std::unique_ptr<Matrix2D<T>> cache;
+
+    const Derived& self() const {
+        return static_cast<const Derived&>(*this);
+    }
+
+    void check(const size_t x, const size_t y) const {
+        if (x >= self().size().first || y >= self().size().second) {
+            throw std::out_of_range("index out of range");
+        }
+    }
+
+    Matrix2D<T>& materialize() {
+        if (!cache) {
+            cache = std::make_unique<Matrix2D<T>>(self());
+        }
+        return *cache;
+    }
+};
+
+template<typename E>
+struct IsMatrixExpression : std::is_base_of<MatrixExpressionTag, std::decay_t<E>> { };
+
+// how a node stores an operand it got as 'E&&'
+template<typename E>
+using MatrixOperand = std::conditional_t<std::is_lvalue_reference<E>::value,
+                                         const std::decay_t<E>&, std::decay_t<E>>;
+
+template<typename T, typename E>
+bool writtenOperand(const E& operand) {
+    if constexpr (std::is_same<E, Matrix2D<T>>::value) {
+        return false;
+    } else {
+        return operand.written();
+    }
+}
+
+// element 'index' of an operand; 'Fresh' skips the checks for written nodes
+template<typename T, bool Fresh, typename E>
+T operandElement(const E& operand, const size_t index) {
+    if constexpr (Fresh && !std::is_same<E, Matrix2D<T>>::value) {
+        return operand.fresh(index);
+    } else {
+        return operand.element(index);
+    }
+}
+
+// an owned Matrix2D somewhere in the operand, whose buffer the result may reuse
+template<typename T, typename Operand>
+Matrix2D<T>* ownedMatrix(Operand& operand) {
+    if constexpr (std::is_reference<Operand>::value) {
+        return nullptr;
+    } else if constexpr (std::is_same<Operand, Matrix2D<T>>::value) {
+        return &operand;
+    } else {
+        return operand.owned();
+    }
+}
+
+template<typename T, typename Left, typename Right, typename Operation>
+class MatrixBinaryExpression :
+    public MatrixExpressionNode<T, MatrixBinaryExpression<T, Left, Right, Operation>> {
+public:
+    using value_type = T;
+
+    template<typename L, typename R>
+    MatrixBinaryExpression(L&& left, R&& right) :
+        left(std::forward<L>(left)),
+        right(std::forward<R>(right)) {
+        if (this->left.size() != this->right.size()) {
+            throw std::logic_error("sizes mismatch");
+        }
+    }
+
+    template<bool Fresh>
+    T compute(const size_t index) const {
+        return Operation()(operandElement<T, Fresh>(left, index), operandElement<T, Fresh>(right, index));
+    }
+
+    bool operandsWritten() const {
+        return writtenOperand<T>(left) || writtenOperand<T>(right);
+    }
+
+    std::pair<size_t, size_t> size() const {
+        return left.size();
+    }
+
+    Matrix2D<T>* ownedOperand() {
+        Matrix2D<T>* matrix = ownedMatrix<T, Left>(left);
+        return matrix != nullptr ? matrix : ownedMatrix<T, Right>(right);
+    }
+
+private:
+    Left left;
+    Right right;
+};
+
+// every element of 'source' multiplied by one value
+template<typename T, typename Source>
+class MatrixScaleExpression : public MatrixExpressionNode<T, MatrixScaleExpression<T, Source>> {
+public:
+    using value_type = T;
+
+    template<typename S>
+    MatrixScaleExpression(S&& source, const T& value) :
+        source(std::forward<S>(source)),
+        value(value) {
+        if (this->source.size().first == 0 || this->source.size().second == 0) {
+            throw std::logic_error("cannot multiply zero matrix");
+        }
+    }
+
+    template<bool Fresh>
+    T compute(const size_t index) const {
+        return operandElement<T, Fresh>(source, index) * value;
+    }
+
+    bool operandsWritten() const {
+        return writtenOperand<T>(source);
+    }
+
+    std::pair<size_t, size_t> size() const {
+        return source.size();
+    }
+
+    Matrix2D<T>* ownedOperand() {
+        return ownedMatrix<T, Source>(source);
+    }
+
+private:
+    Source source;
+    T value;
+};
+
+// the operators return nodes, not matrices. 'auto e = a + b' keeps references
+// to 'a' and 'b', so 'e' dangles once they are gone, and it recomputes every
+// element it is read at; 'Matrix2D<T> e = a + b' or '(a + b).eval()' holds
+// the values. Operands passed as rvalues are moved into the node and are safe
+template<typename L, typename R>
+using MatrixBinaryEnable = std::enable_if_t<IsMatrixExpression<L>::value && IsMatrixExpression<R>::value>;
+
+template<typename L, typename R, typename = MatrixBinaryEnable<L, R>>
+auto operator+(L&& left, R&& right) {
+    using T = typename std::decay_t<L>::value_type;
+    return MatrixBinaryExpression<T, MatrixOperand<L&&>, MatrixOperand<R&&>, std::plus<T>>(
+        std::forward<L>(left), std::forward<R>(right));
+}
+
+template<typename L, typename R, typename = MatrixBinaryEnable<L, R>>
+auto operator-(L&& left, R&& right) {
+    using T = typename std::decay_t<L>::value_type;
+    return MatrixBinaryExpression<T, MatrixOperand<L&&>, MatrixOperand<R&&>, std::minus<T>>(
+        std::forward<L>(left), std::forward<R>(right));
+}
+
+template<typename E, typename = std::enable_if_t<IsMatrixExpression<E>::value>>
+auto operator*(E&& source, const typename std::decay_t<E>::value_type& value) {
+    using T = typename std::decay_t<E>::value_type;
+    return MatrixScaleExpression<T, MatrixOperand<E&&>>(std::forward<E>(source), value);
+}
+
+template<typename E, typename = std::enable_if_t<IsMatrixExpression<E>::value>>
+auto operator*(const typename std::decay_t<E>::value_type& value, E&& source) {
+    using T = typename std::decay_t<E>::value_type;
+    return MatrixScaleExpression<T, MatrixOperand<E&&>>(std::forward<E>(source), value);
+}
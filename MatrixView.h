@@ -0,0 +1,92 @@
+#pragma once
+#include <cstddef>
+#include <stdexcept>
+#include <type_traits>
+
+/* Non-owning strided window into row-major storage, e.g. a Matrix2D.
+   Element (i, j) lives at data[i * rowStride + j * columnStride], so
+   submatrices and transposes are views of the same memory without copies.
+   'T' may be const for read-only views.
+
+   Matrix2D<double> m(4, 4);
+   MatrixView<double> block = m.view().submatrix(0, 2, 2, 2);
+   block(0, 0) = 1;
+   MatrixView<const double> t = m.view().transposed();
+ */
+template<typename T>
+class MatrixView {
+public:
+    MatrixView() { }
+    MatrixView(T* data, const size_t rows, const size_t columns,
+               const size_t rowStride, const size_t columnStride = 1) :
+        pointer(data),
+        rows(rows),
+        columns(columns),
+        rowStride(rowStride),
+        columnStride(columnStride) { }
+
+    // a mutable view converts to a read-only one
+    template<typename U, typename = std::enable_if_t<std::is_same<const U, T>::value && !std::is_same<U, T>::value>>
+    MatrixView(const MatrixView<U>& other) :
+        MatrixView(other.data(), other.rowsSize(), other.columnsSize(),
+                   other.rowStrideSize(), other.columnStrideSize()) { }
+
+    // unchecked access
+    T& operator()(const size_t i, const size_t j) const {
+        return pointer[i * rowStride + j * columnStride];
+    }
+
+    T& at(const size_t i, const size_t j) const {
+        if (i >= rows || j >= columns) {
+            throw std::out_of_range("index out of range");
+        }
+        return (*this)(i, j);
+    }
+
+    // 'countRows' x 'countColumns' block starting at (row, column)
+    MatrixView submatrix(const size_t row, const size_t column,
+                         const size_t countRows, const size_t countColumns) const {
+        if (row > rows || column > columns ||
+            countRows > rows - row || countColumns > columns - column) {
+            throw std::out_of_range("index out of range");
+        }
+        return MatrixView(pointer + row * rowStride + column * columnStride,
+                          countRows, countColumns, rowStride, columnStride);
+    }
+
+    MatrixView transposed() const {
+        return MatrixView(pointer, columns, rows, columnStride, rowStride);
+    }
+
+    T* data() const {
+        return pointer;
+    }
+
+    size_t rowsSize() const {
+        return rows;
+    }
+
+    size_t columnsSize() const {
+        return columns;
+    }
+
+    size_t rowStrideSize() const {
+        return rowStride;
+    }
+
+    size_t columnStrideSize() const {
+        return columnStride;
+    }
+
+    // rows are dense, a row can be walked with a plain pointer
+    bool isRowContiguous() const {
+        return columnStride == 1;
+    }
+
+private:
+    T* pointer = nullptr;
+    size_t rows = 0;
+    size_t columns = 0;
+    size_t rowStride = 0;
+    size_t columnStride = 1;
+};
@@ -0,0 +1,240 @@
+#pragma once
+#include <limits>
+#include <numeric>
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define MONOID_X86_DISPATCH 1
+#endif
+
+/* Monoid policies for SegmentTree2D and the other range structures.
+   A policy is a functor combining two values plus identity().
+   The combine is known at compile time, so it is inlined at every node.
+   Invertible policies (sum, xor) also have inverse(), which FenwickTree2D needs.
+   Idempotent policies (min, max, gcd) set 'idempotent', op(a, a) == a.
+
+   SegmentTree2D<int, SumMonoid<int>> seg(matrix);
+   SegmentTree2D<int, MaxMonoid<int>> seg(matrix);
+ */
+
+template<typename T>
+struct SumMonoid {
+    static constexpr T identity() {
+        return T();
+    }
+
+    T operator()(const T& first, const T& second) const {
+        return first + second;
+    }
+
+    static T inverse(const T& value) {
+        return -value;
+    }
+};
+
+template<typename T>
+struct MinMonoid {
+    static constexpr bool idempotent = true;
+
+    static constexpr T identity() {
+        return std::numeric_limits<T>::has_infinity ?
+               std::numeric_limits<T>::infinity() : std::numeric_limits<T>::max();
+    }
+
+    T operator()(const T& first, const T& second) const {
+        return second < first ? second : first;
+    }
+};
+
+template<typename T>
+struct MaxMonoid {
+    static constexpr bool idempotent = true;
+
+    static constexpr T identity() {
+        return std::numeric_limits<T>::has_infinity ?
+               -std::numeric_limits<T>::infinity() : std::numeric_limits<T>::lowest();
+    }
+
+    T operator()(const T& first, const T& second) const {
+        return first < second ? second : first;
+    }
+};
+
+template<typename T>
+struct XorMonoid {
+    static constexpr T identity() {
+        return T();
+    }
+
+    T operator()(const T& first, const T& second) const {
+        return first ^ second;
+    }
+
+    static T inverse(const T& value) {
+        return value;
+    }
+};
+
+template<typename T>
+struct GcdMonoid {
+    static constexpr bool idempotent = true;
+
+    static constexpr T identity() {
+        return T();
+    }
+
+    T operator()(const T& first, const T& second) const {
+        return std::gcd(first, second);
+    }
+};
+
+template<typename Op, typename = void>
+struct IsIdempotent : std::false_type { };
+
+template<typename Op>
+struct IsIdempotent<Op, std::void_t<decltype(Op::idempotent)>> :
+    std::integral_constant<bool, Op::idempotent> { };
+
+template<typename Op, typename = void>
+struct IsInvertible : std::false_type { };
+
+template<typename Op>
+struct IsInvertible<Op, std::void_t<decltype(&Op::inverse)>> : std::true_type { };
+
+// operation given at run time, kept for the old function pointer constructors
+template<typename T>
+struct FunctionMonoid {
+    FunctionMonoid(T function(const T&, const T&), const T& identityElement) :
+        function(function),
+        identityElement(identityElement) { }
+
+    T identity() const {
+        return identityElement;
+    }
+
+    T operator()(const T& first, const T& second) const {
+        return function(first, second);
+    }
+
+private:
+    T (*function)(const T&, const T&);
+    T identityElement;
+};
+
+#ifdef MONOID_X86_DISPATCH
+// 256-bit lanes of the types the row kernels are written for; compiled for
+// AVX2 whatever the target of the rest of the program, used only when the
+// CPU has it
+template<typename T>
+struct Avx2Lanes {
+    static constexpr bool enabled = false;
+};
+
+template<>
+struct Avx2Lanes<int32_t> {
+    static constexpr bool enabled = true;
+    static constexpr size_t width = 8;
+    using Vector = __m256i;
+    __attribute__((target("avx2"))) static Vector load(const int32_t* data) { return _mm256_loadu_si256(reinterpret_cast<const Vector*>(data)); }
+    __attribute__((target("avx2"))) static void store(int32_t* data, Vector value) { _mm256_storeu_si256(reinterpret_cast<Vector*>(data), value); }
+    __attribute__((target("avx2"))) static Vector add(Vector first, Vector second) { return _mm256_add_epi32(first, second); }
+    __attribute__((target("avx2"))) static Vector min(Vector first, Vector second) { return _mm256_min_epi32(first, second); }
+    __attribute__((target("avx2"))) static Vector max(Vector first, Vector second) { return _mm256_max_epi32(first, second); }
+};
+
+template<>
+struct Avx2Lanes<float> {
+    static constexpr bool enabled = true;
+    static constexpr size_t width = 8;
+    using Vector = __m256;
+    __attribute__((target("avx2"))) static Vector load(const float* data) { return _mm256_loadu_ps(data); }
+    __attribute__((target("avx2"))) static void store(float* data, Vector value) { _mm256_storeu_ps(data, value); }
+    __attribute__((target("avx2"))) static Vector add(Vector first, Vector second) { return _mm256_add_ps(first, second); }
+    // operands swapped so NaN and signed zero behave like the scalar policies
+    __attribute__((target("avx2"))) static Vector min(Vector first, Vector second) { return _mm256_min_ps(second, first); }
+    __attribute__((target("avx2"))) static Vector max(Vector first, Vector second) { return _mm256_max_ps(second, first); }
+};
+
+template<>
+struct Avx2Lanes<double> {
+    static constexpr bool enabled = true;
+    static constexpr size_t width = 4;
+    using Vector = __m256d;
+    __attribute__((target("avx2"))) static Vector load(const double* data) { return _mm256_loadu_pd(data); }
+    __attribute__((target("avx2"))) static void store(double* data, Vector value) { _mm256_storeu_pd(data, value); }
+    __attribute__((target("avx2"))) static Vector add(Vector first, Vector second) { return _mm256_add_pd(first, second); }
+    __attribute__((target("avx2"))) static Vector min(Vector first, Vector second) { return _mm256_min_pd(second, first); }
+    __attribute__((target("avx2"))) static Vector max(Vector first, Vector second) { return _mm256_max_pd(second, first); }
+};
+
+// vector form of a policy, if there is one
+template<typename Op>
+struct Avx2Combine {
+    static constexpr bool enabled = false;
+};
+
+template<typename T>
+struct Avx2Combine<SumMonoid<T>> {
+    using Lanes = Avx2Lanes<T>;
+    static constexpr bool enabled = Lanes::enabled;
+    template<typename Vector>
+    __attribute__((target("avx2"))) static Vector apply(Vector first, Vector second) { return Lanes::add(first, second); }
+};
+
+template<typename T>
+struct Avx2Combine<MinMonoid<T>> {
+    using Lanes = Avx2Lanes<T>;
+    static constexpr bool enabled = Lanes::enabled;
+    template<typename Vector>
+    __attribute__((target("avx2"))) static Vector apply(Vector first, Vector second) { return Lanes::min(first, second); }
+};
+
+template<typename T>
+struct Avx2Combine<MaxMonoid<T>> {
+    using Lanes = Avx2Lanes<T>;
+    static constexpr bool enabled = Lanes::enabled;
+    template<typename Vector>
+    __attribute__((target("avx2"))) static Vector apply(Vector first, Vector second) { return Lanes::max(first, second); }
+};
+
+// whole vectors of the row, returns how many elements it combined
+template<typename T, typename Op>
+__attribute__((target("avx2")))
+size_t combineRowsAvx2(T* target, const T* left, const T* right, size_t size) {
+    using Kernel = Avx2Combine<Op>;
+    using Lanes = typename Kernel::Lanes;
+    size_t i = 0;
+    for (; i + Lanes::width <= size; i += Lanes::width) {
+        Lanes::store(target + i, Kernel::apply(Lanes::load(left + i), Lanes::load(right + i)));
+    }
+    return i;
+}
+
+// checked once per program
+inline bool hasAvx2() {
+    static const bool supported = []() {
+        __builtin_cpu_init();
+        return __builtin_cpu_supports("avx2") != 0;
+    }();
+    return supported;
+}
+#endif
+
+// target[i] = op(left[i], right[i]) for i in [0, size)
+template<typename T, typename Op>
+void combineRows(const Op& op, T* target, const T* left, const T* right, size_t size) {
+    size_t i = 0;
+#ifdef MONOID_X86_DISPATCH
+    if constexpr (Avx2Combine<Op>::enabled) {
+        if (hasAvx2()) {
+            i = combineRowsAvx2<T, Op>(target, left, right, size);
+        }
+    }
+#endif
+    for (; i < size; ++i) {
+        target[i] = op(left[i], right[i]);
+    }
+}
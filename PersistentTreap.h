@@ -0,0 +1,302 @@
+#pragma once
+#include <ctime>
+#include <random>
+#include <memory>
+#include <atomic>
+#include <vector>
+#include <cstdint>
+#include <unordered_set>
+#include "HashOrder.h"
+
+/* Persistent treap: nodes are immutable and shared between versions,
+   every insert/erase copies only the O(log n) nodes on its path, each of
+   them once.
+   snapshot() is O(1) and can be taken from any thread; a snapshot is an
+   immutable view that readers use without locks while the single writer
+   keeps changing the treap. Nodes are freed by reference counting once no
+   version refers to them.
+
+   PersistentTreap<int, std::less<int>> treap;
+   treap.insert(1);
+   auto snapshot = treap.snapshot();
+   treap.insert(2);
+   snapshot.toVector();                   // {1}
+   treap.memoryOverhead(snapshot).nodes;  // nodes kept alive only by 'snapshot'
+ */
+template<typename T, typename Compare = HashOrder<T>>
+class PersistentTreap {
+    struct Node;
+    using NodePtr = std::shared_ptr<const Node>;
+
+    // root published together with the writer version that produced it
+    struct Version {
+        NodePtr root;
+        uint64_t number;
+    };
+    using VersionPtr = std::shared_ptr<const Version>;
+
+public:
+    class Snapshot {
+    public:
+        size_t size() const {
+            return root ? root->count : 0;
+        }
+
+        bool contains(const T& value) const {
+            const Node* node = root;
+            while (node) {
+                if (compare(value, node->value)) {
+                    node = node->left.get();
+                } else if (compare(node->value, value)) {
+                    node = node->right.get();
+                } else {
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        // calls 'function' for every element in order
+        template<typename Function>
+        void forEach(Function function) const {
+            std::vector<const Node*> stack;
+            const Node* node = root;
+            while (node || !stack.empty()) {
+                while (node) {
+                    stack.push_back(node);
+                    node = node->left.get();
+                }
+                node = stack.back();
+                stack.pop_back();
+                function(node->value);
+                node = node->right.get();
+            }
+        }
+
+        std::vector<T> toVector() const {
+            std::vector<T> result;
+            result.reserve(size());
+            forEach([&result](const T& value) { result.push_back(value); });
+            return result;
+        }
+
+    private:
+        friend class PersistentTreap;
+
+        VersionPtr state;
+        const Node* root;
+        Compare compare;
+
+        Snapshot(VersionPtr state, const Compare& compare) :
+            state(std::move(state)),
+            root(this->state->root.get()),
+            compare(compare) { }
+    };
+
+    struct Memory {
+        size_t nodes;
+        size_t bytes;
+    };
+
+    explicit PersistentTreap(const Compare& compare = Compare()) :
+        rnd(time(nullptr)),
+        compare(compare),
+        current(std::make_shared<const Version>(Version{nullptr, 0})) {}
+
+    // O(1): both treaps share all nodes
+    PersistentTreap(const PersistentTreap& other) :
+        rnd(time(nullptr)),
+        compare(other.compare),
+        current(other.loadCurrent()),
+        version(loadCurrent()->number) { }
+
+    void insert(const T& value) {
+        ++version;
+        auto parts = split(loadCurrent()->root, value, true);
+        NodePtr node = std::make_shared<Node>(value, static_cast<uint32_t>(rnd()),
+                                              version, nullptr, nullptr);
+        publish(merge(merge(parts.first, node), parts.second));
+    }
+
+    // removes every element equivalent to 'value'
+    void erase(const T& value) {
+        ++version;
+        auto firstSplit = split(loadCurrent()->root, value, false);
+        auto secondSplit = split(firstSplit.second, value, true);
+        publish(merge(firstSplit.first, secondSplit.second));
+    }
+
+    bool contains(const T& value) const {
+        return snapshot().contains(value);
+    }
+
+    size_t size() const {
+        return snapshot().size();
+    }
+
+    std::vector<T> toVector() const {
+        return snapshot().toVector();
+    }
+
+    Snapshot snapshot() const {
+        return Snapshot(loadCurrent(), compare);
+    }
+
+    // nodes that stay alive only because of 'snapshot', which must have been
+    // taken from this treap since it was last assigned.
+    // nodes of the current version created before the snapshot are shared
+    // with it together with their subtrees, so both walks stop at them
+    Memory memoryOverhead(const Snapshot& snapshot) const {
+        const VersionPtr latest = loadCurrent();
+        const uint64_t snapshotVersion = snapshot.state->number;
+        std::unordered_set<const Node*> shared;
+        std::vector<const Node*> stack;
+        if (latest->root) {
+            stack.push_back(latest->root.get());
+        }
+        while (!stack.empty()) {
+            const Node* node = stack.back();
+            stack.pop_back();
+            if (node->version <= snapshotVersion) {
+                shared.insert(node);
+                continue;
+            }
+            for (const Node* child : {node->left.get(), node->right.get()}) {
+                if (child) {
+                    stack.push_back(child);
+                }
+            }
+        }
+        size_t nodes = 0;
+        if (snapshot.root) {
+            stack.push_back(snapshot.root);
+        }
+        while (!stack.empty()) {
+            const Node* node = stack.back();
+            stack.pop_back();
+            if (shared.count(node)) {
+                continue;
+            }
+            ++nodes;
+            for (const Node* child : {node->left.get(), node->right.get()}) {
+                if (child) {
+                    stack.push_back(child);
+                }
+            }
+        }
+        return {nodes, nodes * sizeof(Node)};
+    }
+
+    void clear() {
+        ++version;
+        publish(nullptr);
+    }
+
+    // O(1): both treaps share all nodes
+    PersistentTreap& operator=(const PersistentTreap& other) {
+        compare = other.compare;
+        VersionPtr shared = other.loadCurrent();
+        version = shared->number;
+        storeCurrent(std::move(shared));
+        return *this;
+    }
+
+private:
+    struct Node {
+        T value;
+        uint32_t priority;
+        uint64_t count;
+        // writer version that created the node
+        uint64_t version;
+        NodePtr left;
+        NodePtr right;
+
+        Node(const T& value, uint32_t priority, uint64_t version,
+             NodePtr left, NodePtr right) :
+            value(value),
+            priority(priority),
+            count(1 + getCount(left) + getCount(right)),
+            version(version),
+            left(std::move(left)),
+            right(std::move(right)) { }
+    };
+
+    std::mt19937 rnd;
+    Compare compare;
+#ifdef __cpp_lib_atomic_shared_ptr
+    std::atomic<VersionPtr> current;
+#else
+    VersionPtr current;
+#endif
+    // last version started by the writer
+    uint64_t version = 0;
+
+    // the free atomic_load/atomic_store overloads for shared_ptr are deprecated
+    // in C++20, which has std::atomic<std::shared_ptr> instead
+    VersionPtr loadCurrent() const {
+#ifdef __cpp_lib_atomic_shared_ptr
+        return current.load();
+#else
+        return std::atomic_load(&current);
+#endif
+    }
+
+    void storeCurrent(VersionPtr state) {
+#ifdef __cpp_lib_atomic_shared_ptr
+        current.store(std::move(state));
+#else
+        std::atomic_store(&current, std::move(state));
+#endif
+    }
+
+    void publish(NodePtr root) {
+        storeCurrent(std::make_shared<const Version>(Version{std::move(root), version}));
+    }
+
+    static uint64_t getCount(const NodePtr& node) {
+        return node ? node->count : 0;
+    }
+
+    // 'node' with other children. a node stamped with the running version was
+    // copied earlier in this update: it is not published yet and has no other
+    // parent, so it is changed in place instead of being copied again
+    NodePtr copy(const NodePtr& node, NodePtr left, NodePtr right) const {
+        if (node->version == version) {
+            Node& own = const_cast<Node&>(*node);
+            own.count = 1 + getCount(left) + getCount(right);
+            own.left = std::move(left);
+            own.right = std::move(right);
+            return node;
+        }
+        return std::make_shared<Node>(node->value, node->priority, version,
+                                      std::move(left), std::move(right));
+    }
+
+    NodePtr merge(const NodePtr& left, const NodePtr& right) const {
+        if (!left) {
+            return right;
+        }
+        if (!right) {
+            return left;
+        }
+        if (left->priority > right->priority) {
+            return copy(left, left->left, merge(left->right, right));
+        } else {
+            return copy(right, merge(left, right->left), right->right);
+        }
+    }
+
+    // left part gets keys less than 'x' (or equal to it if 'orEqual')
+    std::pair<NodePtr, NodePtr> split(const NodePtr& node, const T& x, bool orEqual) const {
+        if (!node) {
+            return {nullptr, nullptr};
+        }
+        if (orEqual ? !compare(x, node->value) : compare(node->value, x)) {
+            auto res = split(node->right, x, orEqual);
+            return {copy(node, node->left, std::move(res.first)), std::move(res.second)};
+        } else {
+            auto res = split(node->left, x, orEqual);
+            return {std::move(res.first), copy(node, std::move(res.second), node->right)};
+        }
+    }
+};
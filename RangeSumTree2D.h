@@ -0,0 +1,132 @@
+#pragma once
+#include <vector>
+#include <stdexcept>
+#include "FenwickTree2D.h"
+
+/* Sum over a matrix with "add delta to a rectangle" updates.
+   Four FenwickTree2D hold the corner deltas d, d*x, d*y and d*x*y,
+   so both rectangle updates and rectangle queries are O(log C * log R).
+   Ranges are inclusive, as in SegmentTree2D.
+
+   RangeSumTree2D<int64_t> tree(matrix);
+   tree.addRange(0, 2, 1, 3, 5);
+   int64_t sum = tree.query(1, 2, 0, 1);
+ */
+template<typename T>
+class RangeSumTree2D {
+public:
+    RangeSumTree2D(const size_t columnsCount, const size_t rowsCount) :
+        columns(columnsCount),
+        rows(rowsCount),
+        trees{Tree(columnsCount, rowsCount), Tree(columnsCount, rowsCount),
+              Tree(columnsCount, rowsCount), Tree(columnsCount, rowsCount)} { }
+
+    explicit RangeSumTree2D(const std::vector<std::vector<T>>& matrix) :
+        RangeSumTree2D(matrix.size(), matrix.empty() ? 0 : matrix.at(0).size()) {
+        build(matrix);
+    }
+
+    // adds 'delta' to every cell of [fromColumn, toColumn], [fromRow, toRow]
+    void addRange(const size_t fromColumn, const size_t toColumn,
+                  const size_t fromRow, const size_t toRow, const T& delta) {
+        check(fromColumn, toColumn, fromRow, toRow);
+        addCorner(fromColumn + 1, fromRow + 1, delta);
+        addCorner(fromColumn + 1, toRow + 2, -delta);
+        addCorner(toColumn + 2, fromRow + 1, -delta);
+        addCorner(toColumn + 2, toRow + 2, delta);
+    }
+
+    void update(const size_t column, const size_t row, const T& newValue) {
+        addRange(column, column, row, row, newValue - query(column, column, row, row));
+    }
+
+    // get sum on range [fromColumn, toColumn], [fromRow, toRow], 0 for an empty range
+    T query(const size_t fromColumn, const size_t toColumn,
+            const size_t fromRow, const size_t toRow) const {
+        if (fromColumn > toColumn || fromRow > toRow) {
+            check(toColumn, toColumn, toRow, toRow);
+            return T(0);
+        }
+        check(fromColumn, toColumn, fromRow, toRow);
+        return prefix(toColumn + 1, toRow + 1) - prefix(fromColumn, toRow + 1) -
+               prefix(toColumn + 1, fromRow) + prefix(fromColumn, fromRow);
+    }
+
+    size_t columnsSize() const {
+        return columns;
+    }
+
+    size_t rowsSize() const {
+        return rows;
+    }
+
+private:
+    using Tree = FenwickTree2D<T, SumMonoid<T>>;
+
+    size_t columns;
+    size_t rows;
+    // Fenwick trees over d, d * x, d * y and d * x * y, with 1-based x and y
+    Tree trees[4];
+
+    void check(const size_t fromColumn, const size_t toColumn,
+               const size_t fromRow, const size_t toRow) const {
+        if (fromColumn > toColumn || fromRow > toRow ||
+            toColumn >= columns || toRow >= rows) {
+            throw std::out_of_range("index out of range");
+        }
+    }
+
+    // point (x, y) is 1-based, points past the matrix are dropped
+    void addCorner(const size_t x, const size_t y, const T& delta) {
+        if (x > columns || y > rows) {
+            return;
+        }
+        const T xs = static_cast<T>(x);
+        const T ys = static_cast<T>(y);
+        trees[0].add(x - 1, y - 1, delta);
+        trees[1].add(x - 1, y - 1, delta * xs);
+        trees[2].add(x - 1, y - 1, delta * ys);
+        trees[3].add(x - 1, y - 1, delta * xs * ys);
+    }
+
+    // sum over the first x columns and y rows
+    T prefix(const size_t x, const size_t y) const {
+        if (x == 0 || y == 0) {
+            return T();
+        }
+        const T xs = static_cast<T>(x);
+        const T ys = static_cast<T>(y);
+        return trees[0].prefixQuery(x - 1, y - 1) * (xs + 1) * (ys + 1) -
+               trees[1].prefixQuery(x - 1, y - 1) * (ys + 1) -
+               trees[2].prefixQuery(x - 1, y - 1) * (xs + 1) +
+               trees[3].prefixQuery(x - 1, y - 1);
+    }
+
+    // corner deltas of the matrix itself, each tree is then built in O(C * R)
+    void build(const std::vector<std::vector<T>>& matrix) {
+        auto at = [&matrix](size_t x, size_t y) {
+            return x == 0 || y == 0 ? T() : matrix[x - 1][y - 1];
+        };
+        std::vector<std::vector<T>> deltas[4];
+        for (std::vector<std::vector<T>>& delta : deltas) {
+            delta.assign(columns, std::vector<T>(rows));
+        }
+        for (size_t x = 1; x <= columns; ++x) {
+            if (matrix[x - 1].size() != rows) {
+                throw std::invalid_argument("rows have different sizes");
+            }
+            for (size_t y = 1; y <= rows; ++y) {
+                const T delta = at(x, y) - at(x - 1, y) - at(x, y - 1) + at(x - 1, y - 1);
+                const T xs = static_cast<T>(x);
+                const T ys = static_cast<T>(y);
+                deltas[0][x - 1][y - 1] = delta;
+                deltas[1][x - 1][y - 1] = delta * xs;
+                deltas[2][x - 1][y - 1] = delta * ys;
+                deltas[3][x - 1][y - 1] = delta * xs * ys;
+            }
+        }
+        for (size_t tree = 0; tree < 4; ++tree) {
+            trees[tree] = Tree(deltas[tree]);
+        }
+    }
+};
@@ -0,0 +1,131 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+#include <stdexcept>
+#include <algorithm>
+
+// DisjointSetUnion over compact 0..n-1 ids whose unions can be undone.
+// Union by rank without path compression keeps every find O(log n), and each
+// successful union writes exactly one record to the undo log.
+class RollbackDisjointSetUnion {
+public:
+    RollbackDisjointSetUnion() { }
+    explicit RollbackDisjointSetUnion(size_t count) {
+        makeSets(count);
+    }
+
+    RollbackDisjointSetUnion(const RollbackDisjointSetUnion& other) = default;
+    RollbackDisjointSetUnion(RollbackDisjointSetUnion&& other) = default;
+
+    // creates 'count' singleton sets and returns the id of the first one
+    uint32_t makeSets(size_t count) {
+        const size_t first = parent.size();
+        if (count > UINT32_MAX - first) {
+            throw std::length_error("too many sets");
+        }
+        parent.resize(first + count);
+        rank.resize(first + count, 0);
+        for (size_t i = first; i < parent.size(); i++) {
+            parent[i] = static_cast<uint32_t>(i);
+        }
+        components += count;
+        return static_cast<uint32_t>(first);
+    }
+
+    uint32_t findSet(uint32_t set) const {
+        check(set);
+        while (parent[set] != set) {
+            set = parent[set];
+        }
+        return set;
+    }
+
+    // returns false if both elements were already in one set
+    bool unionSets(uint32_t first, uint32_t second) {
+        uint32_t firstParent = findSet(first);
+        uint32_t secondParent = findSet(second);
+        if (firstParent == secondParent) {
+            return false;
+        }
+        if (rank[firstParent] < rank[secondParent]) {
+            std::swap(firstParent, secondParent);
+        }
+        const bool rankIncreased = rank[firstParent] == rank[secondParent];
+        parent[secondParent] = firstParent;
+        if (rankIncreased) {
+            ++rank[firstParent];
+        }
+        --components;
+        history.push_back({secondParent, rankIncreased});
+        return true;
+    }
+
+    bool sameSet(uint32_t first, uint32_t second) const {
+        return findSet(first) == findSet(second);
+    }
+
+    // returns a mark that rollbackTo() can return the forest to
+    size_t checkpoint() const {
+        return history.size();
+    }
+
+    // undoes every union made since 'mark' was taken
+    void rollbackTo(size_t mark) {
+        if (mark > history.size()) {
+            throw std::invalid_argument("invalid checkpoint");
+        }
+        while (history.size() > mark) {
+            rollback();
+        }
+    }
+
+    // undoes the last successful union
+    void rollback() {
+        if (history.empty()) {
+            throw std::invalid_argument("history is empty");
+        }
+        const Change change = history.back();
+        history.pop_back();
+        const uint32_t root = parent[change.child];
+        parent[change.child] = change.child;
+        if (change.rankIncreased) {
+            --rank[root];
+        }
+        ++components;
+    }
+
+    size_t componentsCount() const {
+        return components;
+    }
+
+    size_t size() const {
+        return parent.size();
+    }
+
+    void clear() {
+        parent.clear();
+        rank.clear();
+        history.clear();
+        components = 0;
+    }
+
+    RollbackDisjointSetUnion& operator=(const RollbackDisjointSetUnion& other) = default;
+    RollbackDisjointSetUnion& operator=(RollbackDisjointSetUnion&& other) = default;
+
+private:
+    struct Change {
+        uint32_t child;
+        bool rankIncreased;
+    };
+
+    std::vector<uint32_t> parent;
+    std::vector<uint8_t> rank;
+    std::vector<Change> history;
+    size_t components = 0;
+
+    void check(uint32_t set) const {
+        if (set >= parent.size()) {
+            throw std::out_of_range("set does not exist");
+        }
+    }
+};
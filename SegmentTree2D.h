@@ -19,6 +19,11 @@
             {7, 8, 9}
     };
 
+ 0) Operation known at compile time, see Monoid.h
+
+    SegmentTree2D<int, MaxMonoid<int>> seg(matrix);
+    SegmentTree2D<int, SumMonoid<int>> seg(matrix);
+
  1) Case for maximum
 
     SegmentTree2D<int> seg(matrix, max, -INFINITY);
@@ -31,241 +36,317 @@
     seg.update(0, 0, 12);
     int a = seg.query(1, 2, 1, 2);
 
+ 3) Saved once, queried in place from the file later, see BinaryIO.h
+
+    BinaryIO::save(seg, "grid.bin");
+    MappedSegmentTree2D<int, SumMonoid<int>> mapped("grid.bin");
+    int a = mapped.query(1, 2, 1, 2);
+
  */
 
+#pragma once
+#include <vector>
+#include <stdexcept>
+#include <algorithm>
+#include "Monoid.h"
+#include "ThreadPool.h"
+
+// read-only queries over a flat tree buffer owned by somebody else:
+// a SegmentTree2D or a mapped file
+template<typename T, typename Op>
+class SegmentTree2DView {
+public:
+    SegmentTree2DView(const T* tree, const size_t columns, const size_t rows, const Op& operation) :
+        tree(tree),
+        columns(columns),
+        rows(rows),
+        op(operation),
+        id(operation.identity()) { }
+
+    // get query on range [fromColumn, toColumn], [fromRow, toRow]
+    T query(const size_t fromColumn, const size_t toColumn,
+            const size_t fromRow, const size_t toRow) const {
+        if (toColumn >= columns || toRow >= rows) {
+            throw std::out_of_range("index out of range");
+        }
+        T leftResult = id;
+        T rightResult = id;
+        size_t lower = fromColumn + columns;
+        size_t upper = toColumn + columns + 1;
+        while (lower < upper) {
+            if (lower & 1) {
+                leftResult = op(leftResult, queryRows(lower++, fromRow, toRow));
+            }
+            if (upper & 1) {
+                rightResult = op(queryRows(--upper, fromRow, toRow), rightResult);
+            }
+            lower >>= 1;
+            upper >>= 1;
+        }
+        return op(leftResult, rightResult);
+    }
+
+private:
+    const T* tree;
+    size_t columns;
+    size_t rows;
+    Op op;
+    T id;
+
+    // query over rows [fromRow, toRow] of column node 'x'
+    T queryRows(const size_t x, const size_t fromRow, const size_t toRow) const {
+        const T* line = tree + x * 2 * rows;
+        T leftResult = id;
+        T rightResult = id;
+        size_t lower = fromRow + rows;
+        size_t upper = toRow + rows + 1;
+        while (lower < upper) {
+            if (lower & 1) {
+                leftResult = op(leftResult, line[lower++]);
+            }
+            if (upper & 1) {
+                rightResult = op(line[--upper], rightResult);
+            }
+            lower >>= 1;
+            upper >>= 1;
+        }
+        return op(leftResult, rightResult);
+    }
+};
 
-template<typename T>
+// The tree is one contiguous (2 * columns) x (2 * rows) buffer: cell (x, y)
+// holds the result over column node x and row node y of two bottom-up
+// segment trees, leaves start at (columns, rows). Queries and updates are
+// non-recursive loops over both axes.
+// 'Op' is a monoid policy from Monoid.h, combined inline at every node.
+template<typename T, typename Op = FunctionMonoid<T>>
 class SegmentTree2D {
 public:
-    // 'id' is a default element of applied operation. i.e. for integers: '0' for sum or '-INFINITY' for maximum
+    struct PointUpdate {
+        size_t column;
+        size_t row;
+        T value;
+    };
+
+    // rectangle [fromColumn, toColumn], [fromRow, toRow]
+    struct RectangleQuery {
+        size_t fromColumn;
+        size_t toColumn;
+        size_t fromRow;
+        size_t toRow;
+    };
+
     explicit SegmentTree2D(const std::vector<std::vector<T>>& initialMatrix,
-                           T function(const T&, const T&), const T& identityElement) {
-        matrix = initialMatrix;
-        func = function;
-        id = identityElement;
-        segmentTree2D.resize(4 * columnsSize(),
-                             std::vector<T>(4 * rowsSize(), 0));
-        build2D(1, Range(0, columnsSize() - 1));
+                           const Op& operation = Op()) :
+        op(operation),
+        id(operation.identity()) {
+        columns = initialMatrix.size();
+        rows = columns == 0 ? 0 : initialMatrix.at(0).size();
+        build(initialMatrix);
     }
 
+    // 'id' is a default element of applied operation. i.e. for integers: '0' for sum or '-INFINITY' for maximum
+    explicit SegmentTree2D(const std::vector<std::vector<T>>& initialMatrix,
+                           T function(const T&, const T&), const T& identityElement) :
+        SegmentTree2D(initialMatrix, Op(function, identityElement)) { }
+
     // get query on range [fromColumn, toColumn], [fromRow, toRow]
     T query(const size_t fromColumn, const size_t toColumn,
                   const size_t fromRow, const size_t toRow) const {
-
-        const Range range(0, columnsSize() - 1);
-        const Rectangle rectangle = {Point(fromColumn, fromRow),
-                                     Point(toColumn, toRow)};
-        const T result = query2D(1, range, rectangle);
-
-        return result;
+        return view().query(fromColumn, toColumn, fromRow, toRow);
     }
 
     void update(const size_t column,
                 const size_t row, const T& newValue) {
+        check(column, row);
+        size_t x = column + columns;
+        cell(x, row + rows) = newValue;
+        for (size_t y = (row + rows) >> 1; y > 0; y >>= 1) {
+            cell(x, y) = op(cell(x, 2 * y), cell(x, 2 * y + 1));
+        }
+        for (x >>= 1; x > 0; x >>= 1) {
+            for (size_t y = row + rows; y > 0; y >>= 1) {
+                cell(x, y) = op(cell(2 * x, y), cell(2 * x + 1, y));
+            }
+        }
+    }
 
-        const Range range(0, columnsSize() - 1);
-        const Point point(column, row);
-        update2D(1, range, point, newValue);
+    // writes all leaves first, then recomputes every affected inner cell once.
+    // columns are visited from the largest node index down, so both children
+    // of a column are final before it; its dirty rows go on to the parent.
+    // an inner column only combines its two children per row, so its rows
+    // need no order and are just deduplicated. later updates of the same cell win
+    void updateBatch(const std::vector<PointUpdate>& updates) {
+        for (const PointUpdate& update : updates) {
+            check(update.column, update.row);
+        }
+        // dirty row nodes of every column node
+        std::vector<std::vector<size_t>> pending(2 * columns);
+        // inner column node whose pending rows already hold the row, 0 for none
+        std::vector<size_t> listed(2 * rows, 0);
+        // leaf column node that already touched the row, 0 for none
+        std::vector<size_t> seen(2 * rows, 0);
+        for (const PointUpdate& update : updates) {
+            const size_t x = update.column + columns;
+            cell(x, update.row + rows) = update.value;
+            pending[x].push_back(update.row + rows);
+        }
+        for (size_t x = 2 * columns - 1; x > 0; --x) {
+            std::vector<size_t> dirtyRows = std::move(pending[x]);
+            if (dirtyRows.empty()) {
+                continue;
+            }
+            if (x >= columns) {
+                dirtyRows = updateRows(x, dirtyRows, seen);
+            } else {
+                for (const size_t y : dirtyRows) {
+                    cell(x, y) = op(cell(2 * x, y), cell(2 * x + 1, y));
+                }
+            }
+            const size_t parent = x / 2;
+            if (parent > 0) {
+                for (const size_t y : dirtyRows) {
+                    if (listed[y] != parent) {
+                        listed[y] = parent;
+                        pending[parent].push_back(y);
+                    }
+                }
+            }
+        }
+    }
+
+    // answers the queries on the shared ThreadPool
+    std::vector<T> queryBatch(const std::vector<RectangleQuery>& queries) const {
+        for (const RectangleQuery& rectangle : queries) {
+            check(rectangle.toColumn, rectangle.toRow);
+        }
+        std::vector<T> result(queries.size(), id);
+        const SegmentTree2DView<T, Op> tree = view();
+        ThreadPool::shared().parallelFor(0, queries.size(), MIN_BATCH, [&](size_t from, size_t to) {
+            for (size_t i = from; i < to; ++i) {
+                result[i] = tree.query(queries[i].fromColumn, queries[i].toColumn,
+                                       queries[i].fromRow, queries[i].toRow);
+            }
+        });
+        return result;
     }
 
     size_t columnsSize() const {
-        const size_t columns = matrix.size();
         return columns;
     }
 
     size_t rowsSize() const {
-        if (columnsSize() == 0) {
-            return 0;
-        }
-        const size_t rows = matrix.at(0).size();
         return rows;
     }
 
-private:
-    std::vector<std::vector<T>> segmentTree2D;
-    std::vector<std::vector<T>> matrix;
-    T (*func)(const T&, const T&);
-    T id;
-
-    class Point {
-    public:
-        size_t x;
-        size_t y;
+    SegmentTree2DView<T, Op> view() const {
+        return SegmentTree2DView<T, Op>(segmentTree2D.data(), columns, rows, op);
+    }
 
-        Point(const size_t xValue,
-              const size_t yValue) {
-            x = xValue;
-            y = yValue;
-        }
-    };
+    // the flat (2 * columns) x (2 * rows) buffer, for BinaryIO::save
+    const T* data() const {
+        return segmentTree2D.data();
+    }
 
-    struct Rectangle {
-        Point bottomLeft;
-        Point topRight;
-    };
+private:
+    std::vector<T> segmentTree2D;
+    size_t columns;
+    size_t rows;
+    Op op;
+    T id;
+    // a rectangle touches O(log columns * log rows) cells, a few hundred ns on a
+    // 4096 x 4096 grid, so a chunk of 1K queries is a fraction of a millisecond
+    static constexpr size_t MIN_BATCH = 1 << 10;
 
-    class Range {
-    public:
-        size_t lowerBound;
-        size_t upperBound;
+    size_t index(const size_t x, const size_t y) const {
+        return x * 2 * rows + y;
+    }
 
-        Range(const size_t lower, const size_t upper) {
-            lowerBound = lower;
-            upperBound = upper;
+    // recomputes the row tree of leaf column 'x' above the written leaves
+    // 'leafRows', returns all touched row nodes. 'seen[y] == x' marks a node
+    // already touched in this column, so the walk up from a leaf stops there.
+    // the children of a node are exactly one level deeper, so recomputing the
+    // touched nodes grouped by depth, deepest first, needs no sort
+    std::vector<size_t> updateRows(const size_t x, const std::vector<size_t>& leafRows,
+                                   std::vector<size_t>& seen) {
+        std::vector<size_t> touched;
+        for (size_t y : leafRows) {
+            for (; y > 0 && seen[y] != x; y >>= 1) {
+                seen[y] = x;
+                touched.push_back(y);
+            }
         }
-
-        bool checkForBoundsEquality() const {
-            const bool result = lowerBound == upperBound;
-            return result;
+        // counting sort by depth, deepest first
+        size_t start[64] = {};
+        for (const size_t y : touched) {
+            ++start[depth(y)];
         }
-
-        size_t getMedium() const {
-            const size_t result = (lowerBound + upperBound) / 2;
-            return result;
+        size_t position = 0;
+        for (size_t level = 64; level-- > 0;) {
+            const size_t count = start[level];
+            start[level] = position;
+            position += count;
         }
-    };
-
-    // builds segment tree along the first (x) axis.
-    void build(std::vector<T>* segmentTree,
-               const std::vector<T>& array,
-               const size_t index, const Range& range) {
-
-        if (range.checkForBoundsEquality()) {
-            segmentTree->at(index) = array.at(range.lowerBound);
-        } else {
-            const size_t medium = range.getMedium();
-
-            build(segmentTree, array, 2 * index,
-                  Range(range.lowerBound, medium));
-            build(segmentTree, array, 2 * index + 1,
-                  Range(medium + 1, range.upperBound));
-
-            segmentTree->at(index) = func(segmentTree->at(2 * index),
-                                              segmentTree->at(2 * index + 1));
+        std::vector<size_t> result(touched.size());
+        for (const size_t y : touched) {
+            result[start[depth(y)]++] = y;
         }
-    }
-
-    // builds final version of segment tree along the second (y) axis.
-    // call this function to build segment tree.
-    void build2D(const size_t index, const Range& range) {
-        if (range.checkForBoundsEquality()) {
-            build(&segmentTree2D.at(index),
-                  matrix.at(range.lowerBound), 1,
-                  Range(0, rowsSize() - 1));
-        } else {
-            const size_t medium = range.getMedium();
-            build2D(2 * index, Range(range.lowerBound, medium));
-            build2D(2 * index + 1, Range(medium + 1, range.upperBound));
-
-            const size_t rowSize = segmentTree2D.at(index).size();
-
-            for (size_t column = 0; column < rowSize; ++column) {
-                segmentTree2D.at(index).at(column) =
-                        func(segmentTree2D.at(2 * index).at(column),
-                                 segmentTree2D.at(2 * index + 1).at(column));
+        for (const size_t y : result) {
+            if (y < rows) {
+                cell(x, y) = op(cell(x, 2 * y), cell(x, 2 * y + 1));
             }
         }
+        return result;
     }
 
-    // finds maximum value in segment tree along the first (x) axis.
-    T query(const std::vector<T>& segmentTree, const size_t index,
-                  const Range& queryRange, const Range& fixedRange) const {
-        if (fixedRange.lowerBound > queryRange.upperBound ||
-            fixedRange.upperBound < queryRange.lowerBound) {
-            return id;
-        }
-
-        if (queryRange.lowerBound >= fixedRange.lowerBound &&
-            queryRange.upperBound <= fixedRange.upperBound) {
-            return segmentTree.at(index);
+    static size_t depth(size_t node) {
+#if defined(__GNUC__)
+        return 63 - __builtin_clzll(node);
+#else
+        size_t result = 0;
+        while (node >>= 1) {
+            ++result;
         }
-
-        const size_t medium = queryRange.getMedium();
-        const T leftQuery = query(segmentTree, 2 * index,
-                                        Range(queryRange.lowerBound, medium), fixedRange);
-        const T rightQuery = query(segmentTree, 2 * index + 1,
-                                         Range(medium + 1, queryRange.upperBound), fixedRange);
-
-        const T result = func(leftQuery, rightQuery);
         return result;
+#endif
     }
 
-    // finds maximum value in segment tree
-    // along the second (y) axis and returns final result.
-    // call this function to get maximum value in the rectangle.
-    T query2D(const size_t index,
-                    const Range& columnsRange,
-                    const Rectangle& rect) const {
-        if (columnsRange.lowerBound > rect.topRight.x ||
-            columnsRange.upperBound < rect.bottomLeft.x) {
-            return id;
-        }
-
-        if (columnsRange.lowerBound >= rect.bottomLeft.x &&
-            columnsRange.upperBound <= rect.topRight.x) {
-            const T queryResult = query(segmentTree2D[index], 1,
-                                              Range(0, rowsSize() - 1),
-                                              Range(rect.bottomLeft.y, rect.topRight.y));
-            return queryResult;
-        }
-
-        const size_t medium = columnsRange.getMedium();
-        const T leftQuery = query2D(2 * index,
-                                          Range(columnsRange.lowerBound, medium), rect);
-        const T rightQuery = query2D(2 * index + 1,
-                                           Range(medium + 1, columnsRange.upperBound), rect);
-        const T result = func(leftQuery, rightQuery);
-
-        return result;
+    T& cell(const size_t x, const size_t y) {
+        return segmentTree2D[index(x, y)];
     }
 
-    // updates segment tree along the first (x) axis.
-    void update(const Range& columnRange,
-                const Range& rowRange, const size_t indexX,
-                const size_t indexY,
-                const Point& point, const T& value) {
+    const T& cell(const size_t x, const size_t y) const {
+        return segmentTree2D[index(x, y)];
+    }
 
-        if (rowRange.checkForBoundsEquality()) {
-            if (columnRange.checkForBoundsEquality()) {
-                segmentTree2D.at(indexX).at(indexY) = value;
-            } else {
-                segmentTree2D.at(indexX).at(indexY) =
-                        func(segmentTree2D.at(indexX * 2).at(indexY),
-                                 segmentTree2D.at(indexX * 2 + 1).at(indexY));
-            }
-        } else {
-            const size_t mediumRow = rowRange.getMedium();
-            if (point.y <= mediumRow) {
-                update(columnRange,
-                       Range(rowRange.lowerBound, mediumRow),
-                       indexX, indexY * 2, point, value);
-            } else {
-                update(columnRange,
-                       Range(mediumRow + 1, rowRange.upperBound),
-                       indexX, indexY * 2 + 1, point, value);
-            }
-            segmentTree2D.at(indexX).at(indexY) =
-                    func(segmentTree2D.at(indexX).at(indexY * 2),
-                             segmentTree2D.at(indexX).at(indexY * 2 + 1));
+    void check(const size_t column, const size_t row) const {
+        if (column >= columns || row >= rows) {
+            throw std::out_of_range("index out of range");
         }
     }
 
-    // updates segment tree along the second (y) axis.
-    // call this function to update value in the tree.
-    void update2D(const size_t index, const Range& columnRange,
-                  const Point& point, const T& value) {
-        if (!columnRange.checkForBoundsEquality()) {
-            const size_t medium = columnRange.getMedium();
-            if (point.x <= medium){
-                update2D(index * 2,
-                         Range(columnRange.lowerBound, medium), point, value);
-            } else {
-                update2D(index * 2 + 1,
-                         Range(medium + 1, columnRange.upperBound), point, value);
+    // leaves first, then the rows of every leaf column,
+    // then every inner column from its two children, row by row
+    void build(const std::vector<std::vector<T>>& matrix) {
+        segmentTree2D.assign(4 * columns * rows, id);
+        if (columns == 0 || rows == 0) {
+            return;
+        }
+        for (size_t column = 0; column < columns; ++column) {
+            const size_t x = column + columns;
+            if (matrix[column].size() != rows) {
+                throw std::invalid_argument("rows have different sizes");
+            }
+            for (size_t row = 0; row < rows; ++row) {
+                cell(x, row + rows) = matrix[column][row];
+            }
+            for (size_t y = rows - 1; y > 0; --y) {
+                cell(x, y) = op(cell(x, 2 * y), cell(x, 2 * y + 1));
             }
         }
-
-        update(columnRange, Range(0, rowsSize() - 1),
-               index, 1, point, value);
+        for (size_t x = columns - 1; x > 0; --x) {
+            combineRows(op, &cell(x, 1), &cell(2 * x, 1),
+                        &cell(2 * x + 1, 1), 2 * rows - 1);
+        }
     }
 };
@@ -0,0 +1,522 @@
+#pragma once
+#include <limits>
+#include <vector>
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+#include <stdexcept>
+#include <type_traits>
+#include "Gemm.h"
+#include "MatrixView.h"
+#include "ThreadPool.h"
+
+/* Semiring policies for Matrix2D::multiply and Matrix2D::pow.
+   A policy has zero() (the identity of add, absorbing for multiply),
+   one() (the identity of multiply) and accumulateRow(target, value,
+   source, count), which sets target[j] = add(target[j], multiply(value,
+   source[j])) for the whole row. The generic product walks rows with it;
+   a policy with its own multiply(a, b, c) replaces the product entirely.
+
+    - PlusTimesSemiring<T>: ordinary arithmetic, products go to Gemm;
+    - ModularSemiring: uint32_t values modulo p, Barrett reduction once
+      per several products accumulated in 64 bits; operands are reduced
+      on entry, so they may hold any uint32_t;
+    - MinPlusSemiring<T>, MaxPlusSemiring<T>: shortest / longest paths,
+      zero() is the infinity, which absorbs additions. Integer sums
+      saturate: one past the largest or the lowest value is clamped to it,
+      so a path that overflows towards the infinity becomes the infinity.
+      MaxPlusSemiring needs a signed T, the lowest() of an unsigned one
+      would be its one(). Rows use AVX-512 or AVX2 when the CPU has them.
+
+   Matrix2D<uint32_t> fib = step.pow(n, ModularSemiring(1'000'000'007));
+   Matrix2D<int64_t> distances = weights.pow(n - 1, MinPlusSemiring<int64_t>());
+ */
+
+// Row kernels written with GCC vector extensions, so they are vectorized
+// at -O2 as well. 'Bytes' is the vector width: 16 for the baseline build,
+// 32 and 64 for the AVX2 and AVX-512 copies chosen at run time. Compilers
+// without the extensions get scalar loops with the same results.
+namespace SemiringRows {
+    // a + b clamped to [lowest(), max()] for integers, the plain sum for floating point
+    template<typename T>
+    inline T saturatingAdd(const T a, const T b) {
+        if constexpr (std::is_floating_point<T>::value) {
+            return a + b;
+        } else {
+#if defined(__GNUC__)
+            T sum;
+            if (__builtin_add_overflow(a, b, &sum)) {
+                return std::is_signed<T>::value && a < 0 ?
+                       std::numeric_limits<T>::lowest() : std::numeric_limits<T>::max();
+            }
+            return sum;
+#else
+            if (b > T(0) && a > std::numeric_limits<T>::max() - b) {
+                return std::numeric_limits<T>::max();
+            }
+            if (b < T(0) && a < std::numeric_limits<T>::lowest() - b) {
+                return std::numeric_limits<T>::lowest();
+            }
+            return static_cast<T>(a + b);
+#endif
+        }
+    }
+
+#if defined(__GNUC__)
+
+    // result = a + b lane by lane, clamped the same way, where every lane of
+    // 'b' is >= 0 when 'Upward' and < 0 otherwise. the sum wraps in unsigned
+    // lanes, and only overflows in the direction of 'b'. vectors go by
+    // reference to keep the ABI of the baseline build
+    template<typename T, bool Upward, typename Vector>
+    GEMM_ALWAYS_INLINE void saturatingAdd(Vector& result, const Vector& a, const Vector& b) {
+        if constexpr (std::is_floating_point<T>::value) {
+            result = a + b;
+        } else {
+            typedef std::make_unsigned_t<T> Unsigned __attribute__((vector_size(sizeof(Vector))));
+            const Vector sum = (Vector)((Unsigned)a + (Unsigned)b);
+            if constexpr (Upward) {
+                result = sum < a ? Vector{} + std::numeric_limits<T>::max() : sum;
+            } else {
+                result = a < sum ? Vector{} + std::numeric_limits<T>::lowest() : sum;
+            }
+        }
+    }
+
+    // target[j] = best(target[j], value + source[j]) for value >= 0 when
+    // 'Upward', value < 0 otherwise. when the sums saturate towards the
+    // infinity, an infinite source stays infinite without a check
+    template<typename T, bool Minimum, bool Upward, size_t Bytes>
+    GEMM_ALWAYS_INLINE void tropicalRow(T* target, const T value, const T* source,
+                                        const size_t count, const T infinity) {
+        typedef T Vector __attribute__((vector_size(Bytes)));
+        constexpr size_t LANES = Bytes / sizeof(T);
+        constexpr bool SATURATES_TO_INFINITY = std::is_integral<T>::value && Minimum == Upward;
+        const Vector values = Vector{} + value;
+        const Vector infinities = Vector{} + infinity;
+        size_t j = 0;
+        for (; j + LANES <= count; j += LANES) {
+            Vector next;
+            Vector current;
+            Vector sum;
+            std::memcpy(&next, source + j, Bytes);
+            std::memcpy(&current, target + j, Bytes);
+            saturatingAdd<T, Upward>(sum, next, values);
+            if constexpr (!SATURATES_TO_INFINITY) {
+                sum = next == infinities ? infinities : sum;
+            }
+            current = Minimum ? (sum < current ? sum : current) : (current < sum ? sum : current);
+            std::memcpy(target + j, &current, Bytes);
+        }
+        for (; j < count; ++j) {
+            const T sum = source[j] == infinity ? infinity : saturatingAdd(value, source[j]);
+            target[j] = Minimum ? std::min(sum, target[j]) : std::max(sum, target[j]);
+        }
+    }
+
+    // target[j] = best(target[j], value + source[j]), 'infinity' absorbs the addition
+    template<typename T, bool Minimum, size_t Bytes>
+    GEMM_ALWAYS_INLINE void tropical(T* target, const T value, const T* source,
+                                     const size_t count, const T infinity) {
+        if constexpr (std::is_signed<T>::value) {
+            if (value < T(0)) {
+                tropicalRow<T, Minimum, false, Bytes>(target, value, source, count, infinity);
+                return;
+            }
+        }
+        tropicalRow<T, Minimum, true, Bytes>(target, value, source, count, infinity);
+    }
+
+    // 32-bit lanes widened to 64-bit ones; the conversion needs concrete types
+    template<size_t Bytes>
+    struct Widening;
+
+    template<>
+    struct Widening<16> {
+        typedef uint64_t Wide __attribute__((vector_size(16)));
+        typedef uint32_t Narrow __attribute__((vector_size(8)));
+
+        static GEMM_ALWAYS_INLINE void convert(const Narrow& narrow, Wide& wide) {
+            wide = __builtin_convertvector(narrow, Wide);
+        }
+    };
+
+    template<>
+    struct Widening<32> {
+        typedef uint64_t Wide __attribute__((vector_size(32)));
+        typedef uint32_t Narrow __attribute__((vector_size(16)));
+
+        static GEMM_ALWAYS_INLINE void convert(const Narrow& narrow, Wide& wide) {
+            wide = __builtin_convertvector(narrow, Wide);
+        }
+    };
+
+    template<>
+    struct Widening<64> {
+        typedef uint64_t Wide __attribute__((vector_size(64)));
+        typedef uint32_t Narrow __attribute__((vector_size(32)));
+
+        static GEMM_ALWAYS_INLINE void convert(const Narrow& narrow, Wide& wide) {
+            wide = __builtin_convertvector(narrow, Wide);
+        }
+    };
+
+    // sums[j] += value * source[j] with 64-bit products of 32-bit values
+    template<size_t Bytes>
+    GEMM_ALWAYS_INLINE void widening(uint64_t* sums, const uint64_t value,
+                                     const uint32_t* source, const size_t count) {
+        using Wide = typename Widening<Bytes>::Wide;
+        using Narrow = typename Widening<Bytes>::Narrow;
+        constexpr size_t LANES = Bytes / sizeof(uint64_t);
+        const Wide values = Wide{} + value;
+        size_t j = 0;
+        for (; j + LANES <= count; j += LANES) {
+            Narrow narrow;
+            Wide wide;
+            Wide current;
+            std::memcpy(&narrow, source + j, Bytes / 2);
+            std::memcpy(&current, sums + j, Bytes);
+            Widening<Bytes>::convert(narrow, wide);
+            current += values * wide;
+            std::memcpy(sums + j, &current, Bytes);
+        }
+        for (; j < count; ++j) {
+            sums[j] += value * source[j];
+        }
+    }
+#else
+    // one element at a time, 'Bytes' only tells the copies apart
+    template<typename T, bool Minimum, size_t Bytes>
+    GEMM_ALWAYS_INLINE void tropical(T* target, const T value, const T* source,
+                                     const size_t count, const T infinity) {
+        for (size_t j = 0; j < count; ++j) {
+            const T sum = source[j] == infinity ? infinity : saturatingAdd(value, source[j]);
+            target[j] = Minimum ? std::min(sum, target[j]) : std::max(sum, target[j]);
+        }
+    }
+
+    template<size_t Bytes>
+    GEMM_ALWAYS_INLINE void widening(uint64_t* sums, const uint64_t value,
+                                     const uint32_t* source, const size_t count) {
+        for (size_t j = 0; j < count; ++j) {
+            sums[j] += value * source[j];
+        }
+    }
+#endif
+
+    template<typename T>
+    using TropicalKernel = void (*)(T* target, T value, const T* source, size_t count, T infinity);
+    using WideningKernel = void (*)(uint64_t* sums, uint64_t value, const uint32_t* source, size_t count);
+
+    template<typename T, bool Minimum, size_t Bytes>
+    void tropicalKernel(T* target, const T value, const T* source, const size_t count, const T infinity) {
+        tropical<T, Minimum, Bytes>(target, value, source, count, infinity);
+    }
+
+    template<size_t Bytes>
+    void wideningKernel(uint64_t* sums, const uint64_t value, const uint32_t* source, const size_t count) {
+        widening<Bytes>(sums, value, source, count);
+    }
+
+#ifdef GEMM_X86_DISPATCH
+    template<typename T, bool Minimum>
+    __attribute__((target("avx2")))
+    void tropicalAvx2(T* target, const T value, const T* source, const size_t count, const T infinity) {
+        tropical<T, Minimum, 32>(target, value, source, count, infinity);
+    }
+
+    template<typename T, bool Minimum>
+    __attribute__((target("avx512f,avx512dq,avx512bw,avx512vl")))
+    void tropicalAvx512(T* target, const T value, const T* source, const size_t count, const T infinity) {
+        tropical<T, Minimum, 64>(target, value, source, count, infinity);
+    }
+
+    __attribute__((target("avx2")))
+    inline void wideningAvx2(uint64_t* sums, const uint64_t value, const uint32_t* source, const size_t count) {
+        widening<32>(sums, value, source, count);
+    }
+
+    __attribute__((target("avx512f,avx512dq,avx512bw,avx512vl")))
+    inline void wideningAvx512(uint64_t* sums, const uint64_t value, const uint32_t* source, const size_t count) {
+        widening<64>(sums, value, source, count);
+    }
+
+    inline bool hasAvx512() {
+        __builtin_cpu_init();
+        return __builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512dq") &&
+               __builtin_cpu_supports("avx512bw") && __builtin_cpu_supports("avx512vl");
+    }
+
+    inline bool hasAvx2() {
+        __builtin_cpu_init();
+        return __builtin_cpu_supports("avx2");
+    }
+#endif
+
+    // picked once per type on first use
+    template<typename T, bool Minimum>
+    TropicalKernel<T> tropicalChoice() {
+        static const TropicalKernel<T> chosen = []() -> TropicalKernel<T> {
+#ifdef GEMM_X86_DISPATCH
+            if (hasAvx512()) {
+                return &tropicalAvx512<T, Minimum>;
+            }
+            if (hasAvx2()) {
+                return &tropicalAvx2<T, Minimum>;
+            }
+#endif
+            return &tropicalKernel<T, Minimum, 16>;
+        }();
+        return chosen;
+    }
+
+    inline WideningKernel wideningChoice() {
+        static const WideningKernel chosen = []() -> WideningKernel {
+#ifdef GEMM_X86_DISPATCH
+            if (hasAvx512()) {
+                return &wideningAvx512;
+            }
+            if (hasAvx2()) {
+                return &wideningAvx2;
+            }
+#endif
+            return &wideningKernel<16>;
+        }();
+        return chosen;
+    }
+}
+
+template<typename T>
+struct PlusTimesSemiring {
+    static constexpr T zero() {
+        return T(0);
+    }
+
+    static constexpr T one() {
+        return T(1);
+    }
+
+    static void accumulateRow(T* target, const T& value, const T* source, const size_t count) {
+        for (size_t j = 0; j < count; ++j) {
+            target[j] += value * source[j];
+        }
+    }
+
+    void multiply(const MatrixView<const T>& a, const MatrixView<const T>& b, const MatrixView<T>& c) const {
+        for (size_t i = 0; i < c.rowsSize(); ++i) {
+            for (size_t j = 0; j < c.columnsSize(); ++j) {
+                c(i, j) = zero();
+            }
+        }
+        Gemm::multiply(a, b, c);
+    }
+};
+
+// arithmetic modulo 'modulus' < 2^32 on uint32_t values, reduced on entry
+class ModularSemiring {
+public:
+    explicit ModularSemiring(const uint32_t modulus) :
+        modulus(modulus),
+        barrett(modulus < 2 ? 0 : ~uint64_t(0) / modulus) {
+        if (modulus < 2) {
+            throw std::invalid_argument("modulus must be at least 2");
+        }
+        // products of reduced values a 64-bit accumulator holds on top of a reduced value
+        const uint64_t largest = uint64_t(modulus - 1) * (modulus - 1);
+        batch = static_cast<size_t>(std::min<uint64_t>((~uint64_t(0) - (modulus - 1)) / largest, 1 << 20));
+    }
+
+    uint32_t zero() const {
+        return 0;
+    }
+
+    uint32_t one() const {
+        return 1;
+    }
+
+    uint32_t reduce(const uint64_t value) const {
+        const uint64_t quotient = multiplyHigh(value, barrett);
+        uint64_t rest = value - quotient * modulus;
+        while (rest >= modulus) {
+            rest -= modulus;
+        }
+        return static_cast<uint32_t>(rest);
+    }
+
+    void accumulateRow(uint32_t* target, const uint32_t& value, const uint32_t* source, const size_t count) const {
+        for (size_t j = 0; j < count; ++j) {
+            target[j] = reduce(target[j] + uint64_t(value) * source[j]);
+        }
+    }
+
+    // rows accumulate 'batch' products in 64 bits between two reductions.
+    // the batch only fits reduced values: 'a' is reduced as it is read,
+    // 'b' into a copy when any of its values is not
+    void multiply(const MatrixView<const uint32_t>& a, const MatrixView<const uint32_t>& b,
+                  const MatrixView<uint32_t>& c) const {
+        const size_t depth = a.columnsSize();
+        const size_t width = c.columnsSize();
+        std::vector<uint32_t> reduced;
+        const MatrixView<const uint32_t> right = reducedView(b, reduced);
+        const SemiringRows::WideningKernel accumulate = SemiringRows::wideningChoice();
+        ThreadPool::shared().parallelFor(0, c.rowsSize(), rowsGrain(depth * width), [&](size_t from, size_t to) {
+            std::vector<uint64_t> sums(width);
+            std::vector<uint32_t> row(width);
+            for (size_t i = from; i < to; ++i) {
+                std::fill(sums.begin(), sums.end(), 0);
+                for (size_t k = 0; k < depth; k += batch) {
+                    for (size_t p = k; p < std::min(depth, k + batch); ++p) {
+                        const uint32_t value = a(i, p) < modulus ? a(i, p) : reduce(a(i, p));
+                        accumulate(sums.data(), value, rowOf(right, p, row), width);
+                    }
+                    for (size_t j = 0; j < width; ++j) {
+                        sums[j] = reduce(sums[j]);
+                    }
+                }
+                for (size_t j = 0; j < width; ++j) {
+                    c(i, j) = static_cast<uint32_t>(sums[j]);
+                }
+            }
+        });
+    }
+
+private:
+    uint64_t modulus;
+    uint64_t barrett;
+    size_t batch;
+
+    // row 'p' of 'b' as a plain array, copied only when it is strided
+    static const uint32_t* rowOf(const MatrixView<const uint32_t>& b, const size_t p, std::vector<uint32_t>& row) {
+        if (b.isRowContiguous()) {
+            return &b(p, 0);
+        }
+        for (size_t j = 0; j < row.size(); ++j) {
+            row[j] = b(p, j);
+        }
+        return row.data();
+    }
+
+    // 'b' itself when all its values are below the modulus, otherwise
+    // a reduced row-major copy of it kept in 'storage'
+    MatrixView<const uint32_t> reducedView(const MatrixView<const uint32_t>& b, std::vector<uint32_t>& storage) const {
+        const size_t rows = b.rowsSize();
+        const size_t columns = b.columnsSize();
+        bool isReduced = true;
+        for (size_t p = 0; p < rows && isReduced; ++p) {
+            for (size_t j = 0; j < columns; ++j) {
+                isReduced &= b(p, j) < modulus;
+            }
+        }
+        if (isReduced) {
+            return b;
+        }
+        storage.resize(rows * columns);
+        for (size_t p = 0; p < rows; ++p) {
+            for (size_t j = 0; j < columns; ++j) {
+                storage[p * columns + j] = reduce(b(p, j));
+            }
+        }
+        return MatrixView<const uint32_t>(storage.data(), rows, columns, columns);
+    }
+
+    // the upper half of the 128-bit product
+    static uint64_t multiplyHigh(const uint64_t a, const uint64_t b) {
+#if defined(__GNUC__) && defined(__SIZEOF_INT128__)
+        return static_cast<uint64_t>((static_cast<unsigned __int128>(a) * b) >> 64);
+#else
+        const uint64_t low = (a & 0xffffffff) * (b & 0xffffffff);
+        const uint64_t first = (a >> 32) * (b & 0xffffffff) + (low >> 32);
+        const uint64_t second = (a & 0xffffffff) * (b >> 32) + (first & 0xffffffff);
+        return (a >> 32) * (b >> 32) + (first >> 32) + (second >> 32);
+#endif
+    }
+
+    static size_t rowsGrain(const size_t workPerRow) {
+        return std::max<size_t>(1, (1 << 16) / std::max<size_t>(workPerRow, 1));
+    }
+};
+
+// add is min, multiply is +, zero() is +infinity (max() for integers)
+template<typename T>
+struct MinPlusSemiring {
+    static constexpr T zero() {
+        return std::numeric_limits<T>::has_infinity ?
+               std::numeric_limits<T>::infinity() : std::numeric_limits<T>::max();
+    }
+
+    static constexpr T one() {
+        return T(0);
+    }
+
+    static void accumulateRow(T* target, const T& value, const T* source, const size_t count) {
+        if (value != zero()) {
+            SemiringRows::tropicalChoice<T, true>()(target, value, source, count, zero());
+        }
+    }
+};
+
+// add is max, multiply is +, zero() is -infinity (lowest() for integers)
+template<typename T>
+struct MaxPlusSemiring {
+    static_assert(std::is_signed<T>::value, "MaxPlusSemiring needs a signed type, lowest() would be one()");
+
+    static constexpr T zero() {
+        return std::numeric_limits<T>::has_infinity ?
+               -std::numeric_limits<T>::infinity() : std::numeric_limits<T>::lowest();
+    }
+
+    static constexpr T one() {
+        return T(0);
+    }
+
+    static void accumulateRow(T* target, const T& value, const T* source, const size_t count) {
+        if (value != zero()) {
+            SemiringRows::tropicalChoice<T, false>()(target, value, source, count, zero());
+        }
+    }
+};
+
+template<typename Semiring, typename T, typename = void>
+struct HasSemiringMultiply : std::false_type { };
+
+template<typename Semiring, typename T>
+struct HasSemiringMultiply<Semiring, T, std::void_t<decltype(std::declval<const Semiring&>().multiply(
+    std::declval<const MatrixView<const T>&>(), std::declval<const MatrixView<const T>&>(),
+    std::declval<const MatrixView<T>&>()))>> : std::true_type { };
+
+// c = a * b over 'semiring', rows of 'c' are split between the threads
+template<typename T, typename Semiring>
+void semiringMultiply(const Semiring& semiring, const MatrixView<const typename Gemm::Identity<T>::type>& a,
+                      const MatrixView<const typename Gemm::Identity<T>::type>& b, const MatrixView<T>& c) {
+    if (a.columnsSize() != b.rowsSize() ||
+        a.rowsSize() != c.rowsSize() || b.columnsSize() != c.columnsSize()) {
+        throw std::logic_error("sizes mismatch");
+    }
+    if constexpr (HasSemiringMultiply<Semiring, T>::value) {
+        semiring.multiply(a, b, c);
+    } else {
+        const size_t depth = a.columnsSize();
+        const size_t width = c.columnsSize();
+        const size_t grain = std::max<size_t>(1, (1 << 16) / std::max<size_t>(depth * width, 1));
+        ThreadPool::shared().parallelFor(0, c.rowsSize(), grain, [&](size_t from, size_t to) {
+            std::vector<T> row(width);
+            std::vector<T> other(b.isRowContiguous() ? 0 : width);
+            for (size_t i = from; i < to; ++i) {
+                std::fill(row.begin(), row.end(), semiring.zero());
+                for (size_t p = 0; p < depth; ++p) {
+                    const T* source = &b(p, 0);
+                    if (!b.isRowContiguous()) {
+                        for (size_t j = 0; j < width; ++j) {
+                            other[j] = b(p, j);
+                        }
+                        source = other.data();
+                    }
+                    semiring.accumulateRow(row.data(), a(i, p), source, width);
+                }
+                for (size_t j = 0; j < width; ++j) {
+                    c(i, j) = row[j];
+                }
+            }
+        });
+    }
+}
@@ -0,0 +1,363 @@
+#pragma once
+#include <cmath>
+#include <vector>
+#include <cstdint>
+#include <utility>
+#include <algorithm>
+#include <stdexcept>
+#include "Matrix2D.h"
+#include "ThreadPool.h"
+
+/* Compressed sparse matrix, in CSR (rows) or CSC (columns) order.
+   'offsets' has one entry per row (CSR) or column (CSC) plus one, the
+   non-zeros of line l are indices/values [offsets[l], offsets[l + 1]),
+   sorted by the other coordinate and stored in 32 bits, so both sides are
+   limited to 2^32 (length_error). Memory and every product are O(nnz)
+   plus the dense operands; zeros are never stored.
+   Products are split between the threads of ThreadPool::shared().
+   CSR gives every task a range of rows holding an equal share of the
+   non-zeros. CSC scatters into the result, so every thread adds its range
+   of columns into a copy of the result of its own and the copies are
+   summed; CSC products with fewer than rows * threads non-zeros stay on
+   the calling thread.
+
+   SparseMatrix<double> a = SparseMatrix<double>::fromTriplets(n, n, triplets);
+   std::vector<double> y = a * x;
+   Matrix2D<double> c = a * dense;
+   std::vector<double> state = a.powMultiply(steps, initial);
+ */
+template<typename T>
+class SparseMatrix {
+public:
+    enum Format {
+        CSR,
+        CSC
+    };
+
+    struct Triplet {
+        size_t row;
+        size_t column;
+        T value;
+    };
+
+    SparseMatrix() { }
+
+    // all zeros
+    SparseMatrix(size_t rows, size_t columns, Format format = CSR) :
+        rows(rows),
+        columns(columns),
+        layout(format),
+        offsets(checkedLines(rows, columns, format) + 1, 0) { }
+
+    // keeps the non-zero elements of a dense matrix
+    explicit SparseMatrix(const Matrix2D<T>& dense, Format format = CSR) :
+        SparseMatrix(dense.size().first, dense.size().second, format) {
+        const size_t outer = lines();
+        const size_t inner = format == CSR ? columns : rows;
+        for (size_t line = 0; line < outer; line++) {
+            for (size_t other = 0; other < inner; other++) {
+                const T& value = format == CSR ? dense(line, other) : dense(other, line);
+                if (value != T(0)) {
+                    indices.push_back(static_cast<uint32_t>(other));
+                    values.push_back(value);
+                }
+            }
+            offsets[line + 1] = values.size();
+        }
+    }
+
+    // duplicates are summed, elements that sum to zero are dropped
+    static SparseMatrix fromTriplets(size_t rows, size_t columns,
+                                     std::vector<Triplet> triplets, Format format = CSR) {
+        SparseMatrix result(rows, columns, format);
+        for (const Triplet& triplet : triplets) {
+            if (triplet.row >= rows || triplet.column >= columns) {
+                throw std::out_of_range("index out of range");
+            }
+        }
+        auto key = [format](const Triplet& triplet) {
+            return format == CSR ? std::make_pair(triplet.row, triplet.column)
+                                 : std::make_pair(triplet.column, triplet.row);
+        };
+        std::sort(triplets.begin(), triplets.end(), [&key](const Triplet& first, const Triplet& second) {
+            return key(first) < key(second);
+        });
+        for (size_t i = 0; i < triplets.size();) {
+            const std::pair<size_t, size_t> position = key(triplets[i]);
+            T sum = triplets[i].value;
+            for (i++; i < triplets.size() && key(triplets[i]) == position; i++) {
+                sum = sum + triplets[i].value;
+            }
+            if (sum != T(0)) {
+                result.indices.push_back(static_cast<uint32_t>(position.second));
+                result.values.push_back(sum);
+                result.offsets[position.first + 1]++;
+            }
+        }
+        for (size_t line = 0; line < result.lines(); line++) {
+            result.offsets[line + 1] += result.offsets[line];
+        }
+        return result;
+    }
+
+    Matrix2D<T> toDense() const {
+        Matrix2D<T> result(rows, columns);
+        for (size_t line = 0; line < lines(); line++) {
+            for (size_t k = offsets[line]; k < offsets[line + 1]; k++) {
+                if (layout == CSR) {
+                    result(line, indices[k]) = values[k];
+                } else {
+                    result(indices[k], line) = values[k];
+                }
+            }
+        }
+        return result;
+    }
+
+    // the same matrix in the other order, a counting sort in O(nnz + lines)
+    SparseMatrix toFormat(Format format) const {
+        if (format == layout) {
+            return *this;
+        }
+        SparseMatrix result(rows, columns, format);
+        for (const uint32_t index : indices) {
+            result.offsets[index + 1]++;
+        }
+        for (size_t line = 0; line < result.lines(); line++) {
+            result.offsets[line + 1] += result.offsets[line];
+        }
+        result.indices.resize(values.size());
+        result.values.resize(values.size());
+        std::vector<size_t> next(result.offsets.begin(), result.offsets.end() - 1);
+        for (size_t line = 0; line < lines(); line++) {
+            for (size_t k = offsets[line]; k < offsets[line + 1]; k++) {
+                const size_t target = next[indices[k]]++;
+                result.indices[target] = static_cast<uint32_t>(line);
+                result.values[target] = values[k];
+            }
+        }
+        return result;
+    }
+
+    // zero for elements that are not stored
+    T at(size_t row, size_t column) const {
+        if (row >= rows || column >= columns) {
+            throw std::out_of_range("index out of range");
+        }
+        const size_t line = layout == CSR ? row : column;
+        const size_t other = layout == CSR ? column : row;
+        const auto begin = indices.begin() + offsets[line];
+        const auto end = indices.begin() + offsets[line + 1];
+        const auto found = std::lower_bound(begin, end, other);
+        return found != end && *found == other ? values[found - indices.begin()] : T(0);
+    }
+
+    std::pair<size_t, size_t> size() const {
+        return {rows, columns};
+    }
+
+    size_t nonZeros() const {
+        return values.size();
+    }
+
+    Format format() const {
+        return layout;
+    }
+
+    // SpMV
+    std::vector<T> operator*(const std::vector<T>& vector) const {
+        std::vector<T> result(rows);
+        multiplyInto(vector, result);
+        return result;
+    }
+
+    // SpMM, sparse times dense
+    Matrix2D<T> operator*(const Matrix2D<T>& dense) const {
+        if (columns != dense.size().first) {
+            throw std::logic_error("sizes mismatch");
+        }
+        const size_t width = dense.size().second;
+        Matrix2D<T> result(rows, width);
+        if (layout == CSR) {
+            forEachRowRange([&](size_t from, size_t to) {
+                for (size_t row = from; row < to; row++) {
+                    T* target = result.data() + row * width;
+                    for (size_t k = offsets[row]; k < offsets[row + 1]; k++) {
+                        addScaled(target, dense.data() + indices[k] * width, values[k], width);
+                    }
+                }
+            });
+        } else {
+            scatterColumns(result.data(), width, [&](T* target, size_t from, size_t to) {
+                for (size_t column = from; column < to; column++) {
+                    const T* source = dense.data() + column * width;
+                    for (size_t k = offsets[column]; k < offsets[column + 1]; k++) {
+                        addScaled(target + size_t(indices[k]) * width, source, values[k], width);
+                    }
+                }
+            });
+        }
+        return result;
+    }
+
+    // this^n * vector. n sparse products with the vector cost O(n * nnz);
+    // squaring a dense copy costs O(rows^3) per bit of n and O(rows^2)
+    // memory. the cheaper of the two runs, the dense one only while its copy
+    // stays within 16 times the non-zeros or 1M elements
+    std::vector<T> powMultiply(size_t n, std::vector<T> vector) const {
+        if (rows != columns) {
+            throw std::logic_error("sizes mismatch");
+        }
+        if (vector.size() != columns) {
+            throw std::logic_error("sizes mismatch");
+        }
+        const double side = static_cast<double>(rows);
+        const double nonZeros = static_cast<double>(values.size());
+        if (side * side <= std::max(16 * nonZeros, double(1 << 20)) &&
+            std::log2(static_cast<double>(n) + 1) * side * side * side < static_cast<double>(n) * nonZeros) {
+            return powMultiplyDense(n, std::move(vector));
+        }
+        std::vector<T> next(rows);
+        for (; n > 0; n--) {
+            multiplyInto(vector, next);
+            vector.swap(next);
+        }
+        return vector;
+    }
+
+private:
+    size_t rows = 0;
+    size_t columns = 0;
+    Format layout = CSR;
+    std::vector<size_t> offsets = {0};
+    std::vector<uint32_t> indices;
+    std::vector<T> values;
+    // fewer non-zeros than this are multiplied on the calling thread
+    static constexpr size_t MIN_PARALLEL = 1 << 15;
+
+    // number of lines of the format; both sides have to fit the 32-bit indices
+    static size_t checkedLines(size_t rows, size_t columns, Format format) {
+        if (rows > size_t(UINT32_MAX) + 1 || columns > size_t(UINT32_MAX) + 1) {
+            throw std::length_error("matrix is too large");
+        }
+        return format == CSR ? rows : columns;
+    }
+
+    size_t lines() const {
+        return offsets.size() - 1;
+    }
+
+    // applies the bits of n from the lowest, squaring a dense copy in between;
+    // all the factors are powers of this matrix, so their order does not matter
+    std::vector<T> powMultiplyDense(size_t n, std::vector<T> vector) const {
+        Matrix2D<T> power = toDense();
+        std::vector<T> next(rows);
+        for (; n > 0; n >>= 1) {
+            if (n & 1) {
+                for (size_t row = 0; row < rows; row++) {
+                    const T* line = power.data() + row * columns;
+                    T sum = T(0);
+                    for (size_t column = 0; column < columns; column++) {
+                        sum += line[column] * vector[column];
+                    }
+                    next[row] = sum;
+                }
+                vector.swap(next);
+            }
+            if (n > 1) {
+                power = power * power;
+            }
+        }
+        return vector;
+    }
+
+    static void addScaled(T* target, const T* source, const T& value, size_t count) {
+        for (size_t j = 0; j < count; j++) {
+            target[j] += value * source[j];
+        }
+    }
+
+    // result = this * vector, 'result' already has 'rows' elements
+    void multiplyInto(const std::vector<T>& vector, std::vector<T>& result) const {
+        if (vector.size() != columns) {
+            throw std::logic_error("sizes mismatch");
+        }
+        if (layout == CSR) {
+            forEachRowRange([&](size_t from, size_t to) {
+                for (size_t row = from; row < to; row++) {
+                    T sum = T(0);
+                    for (size_t k = offsets[row]; k < offsets[row + 1]; k++) {
+                        sum += values[k] * vector[indices[k]];
+                    }
+                    result[row] = sum;
+                }
+            });
+        } else {
+            std::fill(result.begin(), result.end(), T(0));
+            scatterColumns(result.data(), 1, [&](T* target, size_t from, size_t to) {
+                for (size_t column = from; column < to; column++) {
+                    const T& value = vector[column];
+                    for (size_t k = offsets[column]; k < offsets[column + 1]; k++) {
+                        target[indices[k]] += values[k] * value;
+                    }
+                }
+            });
+        }
+    }
+
+    // CSR rows cut into parts of about equal non-zeros, one part per task
+    template<typename Function>
+    void forEachRowRange(Function function) const {
+        ThreadPool& pool = ThreadPool::shared();
+        if (values.size() < MIN_PARALLEL || pool.size() == 1) {
+            function(0, rows);
+            return;
+        }
+        const size_t parts = 4 * pool.size();
+        pool.parallelFor(0, parts, 1, [&](size_t from, size_t to) {
+            const size_t firstNonZero = values.size() * from / parts;
+            const size_t lastNonZero = values.size() * to / parts;
+            // a row belongs to the part holding its first non-zero
+            const size_t firstRow = from == 0 ? 0 :
+                std::lower_bound(offsets.begin(), offsets.end() - 1, firstNonZero) - offsets.begin();
+            const size_t lastRow = to == parts ? rows :
+                std::lower_bound(offsets.begin(), offsets.end() - 1, lastNonZero) - offsets.begin();
+            function(firstRow, lastRow);
+        });
+    }
+
+    // CSC: function(target, from, to) adds the columns [from, to) into the
+    // rows x width 'target', zeroed before. in parallel, every thread takes
+    // columns holding an equal share of the non-zeros and a zeroed copy of the
+    // result of its own, the copies are summed into 'result' at the end.
+    // that costs rows * width * threads extra memory and additions, so it
+    // only runs with at least rows * threads non-zeros
+    template<typename Function>
+    void scatterColumns(T* result, size_t width, Function function) const {
+        ThreadPool& pool = ThreadPool::shared();
+        const size_t parts = pool.size();
+        if (values.size() < MIN_PARALLEL || parts == 1 || rows * parts > values.size()) {
+            function(result, 0, columns);
+            return;
+        }
+        const size_t area = rows * width;
+        std::vector<T> partial((parts - 1) * area, T(0));
+        pool.parallelFor(0, parts, 1, [&](size_t from, size_t to) {
+            for (size_t part = from; part < to; part++) {
+                const size_t firstColumn = part == 0 ? 0 :
+                    std::lower_bound(offsets.begin(), offsets.end() - 1, values.size() * part / parts) - offsets.begin();
+                const size_t lastColumn = part + 1 == parts ? columns :
+                    std::lower_bound(offsets.begin(), offsets.end() - 1, values.size() * (part + 1) / parts) - offsets.begin();
+                function(part == 0 ? result : partial.data() + (part - 1) * area, firstColumn, lastColumn);
+            }
+        });
+        pool.parallelFor(0, area, 1 << 12, [&](size_t from, size_t to) {
+            for (size_t part = 1; part < parts; part++) {
+                const T* source = partial.data() + (part - 1) * area;
+                for (size_t i = from; i < to; i++) {
+                    result[i] += source[i];
+                }
+            }
+        });
+    }
+};
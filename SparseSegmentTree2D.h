@@ -0,0 +1,243 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+#include <stdexcept>
+#include "Monoid.h"
+
+/* SegmentTree2D for huge, mostly empty grids.
+   Nodes are created only along the paths of updated points: every column
+   node owns a row tree, and both kinds of nodes live in pools addressed by
+   32-bit indices. Memory is O(k * log C * log R) for k touched points;
+   untouched cells read as the identity of 'Op'.
+   On a 10^6 x 10^6 grid every new point adds up to ~400 row nodes, so the
+   32-bit row pool runs out (length_error) at roughly 10^7 points, after tens
+   of GB. When the points are known up front, CompressedSegmentTree2D stores
+   each of them only once per column level.
+
+   SparseSegmentTree2D<int64_t, SumMonoid<int64_t>> seg(1'000'000, 1'000'000);
+   seg.update(12, 400'000, 7);
+   int64_t a = seg.query(0, 100, 0, 999'999);
+ */
+template<typename T, typename Op>
+class SparseSegmentTree2D {
+public:
+    SparseSegmentTree2D(const size_t columnsCount, const size_t rowsCount,
+                        const Op& operation = Op()) :
+        columns(columnsCount),
+        rows(rowsCount),
+        op(operation),
+        id(operation.identity()) {
+        clear();
+    }
+
+    // get query on range [fromColumn, toColumn], [fromRow, toRow]
+    T query(const size_t fromColumn, const size_t toColumn,
+            const size_t fromRow, const size_t toRow) const {
+        if (toColumn >= columns || toRow >= rows) {
+            throw std::out_of_range("index out of range");
+        }
+        if (fromColumn > toColumn || fromRow > toRow) {
+            return id;
+        }
+        T result = id;
+        // column nodes still to visit, left to right
+        std::vector<Frame> stack = {{ROOT, 0, columns - 1}};
+        while (!stack.empty()) {
+            const Frame frame = stack.back();
+            stack.pop_back();
+            if (frame.node == NONE || frame.upper < fromColumn || toColumn < frame.lower) {
+                continue;
+            }
+            if (fromColumn <= frame.lower && frame.upper <= toColumn) {
+                result = op(result, queryRows(columnNodes[frame.node].rowRoot, fromRow, toRow));
+                continue;
+            }
+            const size_t medium = frame.lower + (frame.upper - frame.lower) / 2;
+            stack.push_back({columnNodes[frame.node].right, medium + 1, frame.upper});
+            stack.push_back({columnNodes[frame.node].left, frame.lower, medium});
+        }
+        return result;
+    }
+
+    void update(const size_t column, const size_t row, const T& newValue) {
+        if (column >= columns || row >= rows) {
+            throw std::out_of_range("index out of range");
+        }
+        std::vector<uint32_t> path;
+        uint32_t node = ROOT;
+        size_t lower = 0;
+        size_t upper = columns - 1;
+        while (true) {
+            path.push_back(node);
+            if (lower == upper) {
+                break;
+            }
+            const size_t medium = lower + (upper - lower) / 2;
+            const bool goLeft = column <= medium;
+            uint32_t child = goLeft ? columnNodes[node].left : columnNodes[node].right;
+            if (child == NONE) {
+                child = newColumnNode();
+                (goLeft ? columnNodes[node].left : columnNodes[node].right) = child;
+            }
+            node = child;
+            if (goLeft) {
+                upper = medium;
+            } else {
+                lower = medium + 1;
+            }
+        }
+        // the leaf column takes the value, every ancestor recombines its children at 'row'
+        updateRows(path.back(), row, newValue);
+        for (size_t i = path.size() - 1; i-- > 0;) {
+            const ColumnNode& current = columnNodes[path[i]];
+            const T value = op(pointQuery(current.left, row), pointQuery(current.right, row));
+            updateRows(path[i], row, value);
+        }
+    }
+
+    size_t columnsSize() const {
+        return columns;
+    }
+
+    size_t rowsSize() const {
+        return rows;
+    }
+
+    // number of allocated column and row nodes
+    size_t nodesCount() const {
+        return columnNodes.size() + rowNodes.size() - 2;
+    }
+
+    void reserve(size_t columnNodesCount, size_t rowNodesCount) {
+        columnNodes.reserve(columnNodesCount + 1);
+        rowNodes.reserve(rowNodesCount + 1);
+    }
+
+    void clear() {
+        columnNodes.clear();
+        rowNodes.clear();
+        // slot 0 of both pools stands for a missing node
+        columnNodes.push_back({NONE, NONE, NONE});
+        rowNodes.push_back({id, NONE, NONE});
+        newColumnNode();
+    }
+
+private:
+    static constexpr uint32_t NONE = 0;
+    static constexpr uint32_t ROOT = 1;
+
+    struct ColumnNode {
+        uint32_t left;
+        uint32_t right;
+        uint32_t rowRoot;
+    };
+
+    struct RowNode {
+        T value;
+        uint32_t left;
+        uint32_t right;
+    };
+
+    struct Frame {
+        uint32_t node;
+        size_t lower;
+        size_t upper;
+    };
+
+    size_t columns;
+    size_t rows;
+    Op op;
+    T id;
+    std::vector<ColumnNode> columnNodes;
+    std::vector<RowNode> rowNodes;
+
+    uint32_t newColumnNode() {
+        if (columnNodes.size() >= UINT32_MAX) {
+            throw std::length_error("too many nodes");
+        }
+        columnNodes.push_back({NONE, NONE, NONE});
+        return static_cast<uint32_t>(columnNodes.size() - 1);
+    }
+
+    uint32_t newRowNode() {
+        if (rowNodes.size() >= UINT32_MAX) {
+            throw std::length_error("too many nodes");
+        }
+        rowNodes.push_back({id, NONE, NONE});
+        return static_cast<uint32_t>(rowNodes.size() - 1);
+    }
+
+    // value at 'row' in the row tree of column node 'node'
+    T pointQuery(const uint32_t node, const size_t row) const {
+        uint32_t current = node == NONE ? NONE : columnNodes[node].rowRoot;
+        size_t lower = 0;
+        size_t upper = rows - 1;
+        while (current != NONE && lower != upper) {
+            const size_t medium = lower + (upper - lower) / 2;
+            if (row <= medium) {
+                current = rowNodes[current].left;
+                upper = medium;
+            } else {
+                current = rowNodes[current].right;
+                lower = medium + 1;
+            }
+        }
+        return rowNodes[current].value;
+    }
+
+    // sets 'row' of the row tree of column node 'node' to 'value'
+    void updateRows(const uint32_t node, const size_t row, const T& value) {
+        if (columnNodes[node].rowRoot == NONE) {
+            const uint32_t root = newRowNode();
+            columnNodes[node].rowRoot = root;
+        }
+        std::vector<uint32_t> path;
+        uint32_t current = columnNodes[node].rowRoot;
+        size_t lower = 0;
+        size_t upper = rows - 1;
+        while (true) {
+            path.push_back(current);
+            if (lower == upper) {
+                break;
+            }
+            const size_t medium = lower + (upper - lower) / 2;
+            const bool goLeft = row <= medium;
+            uint32_t child = goLeft ? rowNodes[current].left : rowNodes[current].right;
+            if (child == NONE) {
+                child = newRowNode();
+                (goLeft ? rowNodes[current].left : rowNodes[current].right) = child;
+            }
+            current = child;
+            if (goLeft) {
+                upper = medium;
+            } else {
+                lower = medium + 1;
+            }
+        }
+        rowNodes[path.back()].value = value;
+        for (size_t i = path.size() - 1; i-- > 0;) {
+            RowNode& parent = rowNodes[path[i]];
+            parent.value = op(rowNodes[parent.left].value, rowNodes[parent.right].value);
+        }
+    }
+
+    T queryRows(const uint32_t root, const size_t fromRow, const size_t toRow) const {
+        T result = id;
+        std::vector<Frame> stack = {{root, 0, rows - 1}};
+        while (!stack.empty()) {
+            const Frame frame = stack.back();
+            stack.pop_back();
+            if (frame.node == NONE || frame.upper < fromRow || toRow < frame.lower) {
+                continue;
+            }
+            if (fromRow <= frame.lower && frame.upper <= toRow) {
+                result = op(result, rowNodes[frame.node].value);
+                continue;
+            }
+            const size_t medium = frame.lower + (frame.upper - frame.lower) / 2;
+            stack.push_back({rowNodes[frame.node].right, medium + 1, frame.upper});
+            stack.push_back({rowNodes[frame.node].left, frame.lower, medium});
+        }
+        return result;
+    }
+};
@@ -0,0 +1,171 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+#include <stdexcept>
+#include <algorithm>
+#include "Monoid.h"
+#include "ThreadPool.h"
+
+/* Read-only rectangle queries in O(1), for tables that are built once.
+   The layout is chosen by the operation at compile time:
+    - idempotent operations (min, max, gcd) get a 2D sparse table, every
+      query combines four overlapping power-of-two rectangles.
+      Memory is O(C * R * log C * log R);
+    - invertible operations (sum, xor) get a 2D prefix table,
+      every query combines four prefixes. Memory is O((C + 1) * (R + 1)).
+   The build is split by column lines across the shared ThreadPool.
+
+   StaticSegmentTree2D<int, MinMonoid<int>> table(matrix);
+   int a = table.query(1, 2, 1, 2);
+ */
+template<typename T, typename Op>
+class StaticSegmentTree2D {
+    static_assert(IsIdempotent<Op>::value || IsInvertible<Op>::value,
+                  "operation must be idempotent or invertible");
+
+public:
+    explicit StaticSegmentTree2D(const std::vector<std::vector<T>>& matrix,
+                                 const Op& operation = Op()) :
+        columns(matrix.size()),
+        rows(matrix.empty() ? 0 : matrix.at(0).size()),
+        op(operation) {
+        for (const std::vector<T>& line : matrix) {
+            if (line.size() != rows) {
+                throw std::invalid_argument("rows have different sizes");
+            }
+        }
+        logs.assign(std::max(columns, rows) + 1, 0);
+        for (size_t i = 2; i < logs.size(); ++i) {
+            logs[i] = logs[i / 2] + 1;
+        }
+        if constexpr (IsIdempotent<Op>::value) {
+            buildSparseTable(matrix);
+        } else {
+            buildPrefixTable(matrix);
+        }
+    }
+
+    // get query on range [fromColumn, toColumn], [fromRow, toRow]
+    T query(const size_t fromColumn, const size_t toColumn,
+            const size_t fromRow, const size_t toRow) const {
+        if (toColumn >= columns || toRow >= rows) {
+            throw std::out_of_range("index out of range");
+        }
+        if (fromColumn > toColumn || fromRow > toRow) {
+            return op.identity();
+        }
+        if constexpr (IsIdempotent<Op>::value) {
+            const size_t levelX = logs[toColumn - fromColumn + 1];
+            const size_t levelY = logs[toRow - fromRow + 1];
+            const Level& level = levels[levelX * levelsY + levelY];
+            const size_t lastColumn = toColumn + 1 - (size_t(1) << levelX);
+            const size_t lastRow = toRow + 1 - (size_t(1) << levelY);
+            return op(op(table[level.at(fromColumn, fromRow)], table[level.at(lastColumn, fromRow)]),
+                      op(table[level.at(fromColumn, lastRow)], table[level.at(lastColumn, lastRow)]));
+        } else {
+            const T inside = op(prefix(toColumn + 1, toRow + 1), prefix(fromColumn, fromRow));
+            const T outside = op(prefix(fromColumn, toRow + 1), prefix(toColumn + 1, fromRow));
+            return op(inside, Op::inverse(outside));
+        }
+    }
+
+    size_t columnsSize() const {
+        return columns;
+    }
+
+    size_t rowsSize() const {
+        return rows;
+    }
+
+private:
+    // block of the sparse table for rectangles of 2^x columns and 2^y rows
+    struct Level {
+        size_t offset;
+        size_t height;
+
+        size_t at(const size_t column, const size_t row) const {
+            return offset + column * height + row;
+        }
+    };
+
+    size_t columns;
+    size_t rows;
+    Op op;
+    std::vector<T> table;
+    std::vector<Level> levels;
+    size_t levelsY = 0;
+    std::vector<uint8_t> logs;
+
+    // prefix table cell: result over the first x columns and y rows
+    const T& prefix(const size_t x, const size_t y) const {
+        return table[x * (rows + 1) + y];
+    }
+
+    // runs function(column) for every column in [0, count) on the shared ThreadPool
+    template<typename Function>
+    void forEachColumn(const size_t count, Function function) const {
+        const size_t grain = std::max<size_t>(1, MIN_CELLS / std::max<size_t>(1, rows));
+        ThreadPool::shared().parallelFor(0, count, grain, [&](size_t from, size_t to) {
+            for (size_t column = from; column < to; ++column) {
+                function(column);
+            }
+        });
+    }
+
+    // a column line is one streaming pass of combineRows over 'rows' cells;
+    // chunks of 64K cells take tens of microseconds, enough to hide the pool hand-off
+    static constexpr size_t MIN_CELLS = 1 << 16;
+
+    void buildSparseTable(const std::vector<std::vector<T>>& matrix) {
+        if (columns == 0 || rows == 0) {
+            return;
+        }
+        const size_t levelsX = logs[columns] + 1;
+        levelsY = logs[rows] + 1;
+        size_t size = 0;
+        for (size_t x = 0; x < levelsX; ++x) {
+            for (size_t y = 0; y < levelsY; ++y) {
+                const size_t height = rows - (size_t(1) << y) + 1;
+                levels.push_back({size, height});
+                size += (columns - (size_t(1) << x) + 1) * height;
+            }
+        }
+        table.resize(size);
+        for (size_t x = 0; x < levelsX; ++x) {
+            const size_t width = columns - (size_t(1) << x) + 1;
+            for (size_t y = 0; y < levelsY; ++y) {
+                const Level& level = levels[x * levelsY + y];
+                forEachColumn(width, [&](const size_t column) {
+                    T* target = &table[level.at(column, 0)];
+                    if (x == 0 && y == 0) {
+                        std::copy(matrix[column].begin(), matrix[column].end(), target);
+                    } else if (x == 0) {
+                        // two halves along the rows of the same line
+                        const Level& half = levels[y - 1];
+                        const T* source = &table[half.at(column, 0)];
+                        combineRows(op, target, source, source + (size_t(1) << (y - 1)), level.height);
+                    } else {
+                        // two halves along the columns, whole lines at once
+                        const Level& half = levels[(x - 1) * levelsY + y];
+                        combineRows(op, target, &table[half.at(column, 0)],
+                                    &table[half.at(column + (size_t(1) << (x - 1)), 0)], level.height);
+                    }
+                });
+            }
+        }
+    }
+
+    void buildPrefixTable(const std::vector<std::vector<T>>& matrix) {
+        table.assign((columns + 1) * (rows + 1), op.identity());
+        forEachColumn(columns, [&](const size_t column) {
+            T* line = &table[(column + 1) * (rows + 1)];
+            for (size_t row = 0; row < rows; ++row) {
+                line[row + 1] = op(line[row], matrix[column][row]);
+            }
+        });
+        for (size_t x = 1; x <= columns; ++x) {
+            T* line = &table[x * (rows + 1)];
+            combineRows(op, line, line, line - (rows + 1), rows + 1);
+        }
+    }
+};
@@ -0,0 +1,232 @@
+#pragma once
+#include <atomic>
+#include <deque>
+#include <mutex>
+#include <memory>
+#include <thread>
+#include <vector>
+#include <exception>
+#include <functional>
+#include <algorithm>
+#include <condition_variable>
+
+/* Work-stealing thread pool. Every worker owns a deque: it pops its own
+   tasks from the back and steals from the front of the others when idle.
+   parallelFor splits [begin, end) into chunks of at least 'grain' indices
+   that are claimed through one atomic counter; the calling thread works on
+   them too, so nested parallelFor from inside a task cannot deadlock.
+   The first exception thrown by a chunk is rethrown to the caller.
+
+   ThreadPool::shared().parallelFor(0, n, 1024, [&](size_t from, size_t to) {
+       for (size_t i = from; i < to; ++i) {
+           out[i] = f(in[i]);
+       }
+   });
+ */
+class ThreadPool {
+public:
+    // 'threads' == 0 means one per core; the caller of parallelFor is an extra worker
+    explicit ThreadPool(size_t threads = 0) {
+        start(threads);
+    }
+
+    ThreadPool(const ThreadPool& other) = delete;
+    ThreadPool& operator=(const ThreadPool& other) = delete;
+
+    ~ThreadPool() {
+        stop();
+    }
+
+    // pool for the library, sized by the number of cores until resized
+    static ThreadPool& shared() {
+        static ThreadPool pool;
+        return pool;
+    }
+
+    // restarts the pool with a new number of threads, must not race with its work
+    void resize(size_t threads) {
+        stop();
+        start(threads);
+    }
+
+    // number of threads working on a parallelFor, the caller included
+    size_t size() const {
+        return queues.size() + 1;
+    }
+
+    // runs function(from, to) over chunks of [begin, end), returns when all are done
+    template<typename Function>
+    void parallelFor(const size_t begin, const size_t end, size_t grain, Function function) {
+        if (begin >= end) {
+            return;
+        }
+        grain = std::max<size_t>(grain, 1);
+        // a few chunks per thread keep them balanced when chunks differ in cost
+        const size_t chunkSize = std::max(grain, (end - begin + 4 * size() - 1) / (4 * size()));
+        const size_t chunks = (end - begin + chunkSize - 1) / chunkSize;
+        if (chunks == 1 || queues.empty()) {
+            function(begin, end);
+            return;
+        }
+        auto job = std::make_shared<Job>();
+        job->run = [&function, begin, end, chunkSize](const size_t chunk) {
+            const size_t from = begin + chunk * chunkSize;
+            function(from, std::min(end, from + chunkSize));
+        };
+        job->chunks = chunks;
+        const size_t helpers = std::min(queues.size(), chunks - 1);
+        for (size_t i = 0; i < helpers; ++i) {
+            push([job]() { job->work(); });
+        }
+        job->work();
+        {
+            std::unique_lock<std::mutex> lock(job->mutex);
+            job->finished.wait(lock, [&job]() { return job->done == job->chunks; });
+        }
+        if (job->error) {
+            std::rethrow_exception(job->error);
+        }
+    }
+
+private:
+    using Task = std::function<void()>;
+
+    struct Queue {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+
+    // chunks of one parallelFor, shared by the caller and its helper tasks
+    struct Job {
+        std::function<void(size_t)> run;
+        size_t chunks = 0;
+        std::atomic<size_t> next{0};
+        size_t done = 0;
+        std::exception_ptr error;
+        std::mutex mutex;
+        std::condition_variable finished;
+
+        void work() {
+            size_t completed = 0;
+            std::exception_ptr caught;
+            for (size_t chunk = next++; chunk < chunks; chunk = next++) {
+                try {
+                    run(chunk);
+                } catch (...) {
+                    if (!caught) {
+                        caught = std::current_exception();
+                    }
+                }
+                ++completed;
+            }
+            if (completed == 0) {
+                return;
+            }
+            std::lock_guard<std::mutex> lock(mutex);
+            if (caught && !error) {
+                error = caught;
+            }
+            done += completed;
+            if (done == chunks) {
+                finished.notify_all();
+            }
+        }
+    };
+
+    std::vector<std::unique_ptr<Queue>> queues;
+    std::vector<std::thread> workers;
+    std::atomic<size_t> nextQueue{0};
+    std::mutex sleepMutex;
+    std::condition_variable wake;
+    size_t pending = 0;
+    bool stopping = false;
+
+    // index of the worker running on this thread in its pool, or -1
+    static thread_local const ThreadPool* currentPool;
+    static thread_local size_t currentWorker;
+
+    void start(size_t threads) {
+        if (threads == 0) {
+            threads = std::max(1u, std::thread::hardware_concurrency());
+        }
+        // the thread calling parallelFor is one of the 'threads'
+        const size_t count = threads - 1;
+        stopping = false;
+        pending = 0;
+        for (size_t i = 0; i < count; ++i) {
+            queues.push_back(std::make_unique<Queue>());
+        }
+        for (size_t i = 0; i < count; ++i) {
+            workers.emplace_back([this, i]() { loop(i); });
+        }
+    }
+
+    void stop() {
+        {
+            std::lock_guard<std::mutex> lock(sleepMutex);
+            stopping = true;
+        }
+        wake.notify_all();
+        for (std::thread& worker : workers) {
+            worker.join();
+        }
+        workers.clear();
+        queues.clear();
+    }
+
+    // own deque from inside a worker, round robin from outside
+    void push(Task task) {
+        const size_t index = currentPool == this ? currentWorker : nextQueue++ % queues.size();
+        {
+            std::lock_guard<std::mutex> lock(queues[index]->mutex);
+            queues[index]->tasks.push_back(std::move(task));
+        }
+        {
+            std::lock_guard<std::mutex> lock(sleepMutex);
+            ++pending;
+        }
+        wake.notify_one();
+    }
+
+    bool pop(const size_t index, Task& task) {
+        for (size_t i = 0; i < queues.size(); ++i) {
+            Queue& queue = *queues[(index + i) % queues.size()];
+            std::lock_guard<std::mutex> lock(queue.mutex);
+            if (!queue.tasks.empty()) {
+                if (i == 0) {
+                    task = std::move(queue.tasks.back());
+                    queue.tasks.pop_back();
+                } else {
+                    task = std::move(queue.tasks.front());
+                    queue.tasks.pop_front();
+                }
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void loop(const size_t index) {
+        currentPool = this;
+        currentWorker = index;
+        while (true) {
+            {
+                std::unique_lock<std::mutex> lock(sleepMutex);
+                wake.wait(lock, [this]() { return stopping || pending > 0; });
+                if (pending == 0) {
+                    return;
+                }
+                --pending;
+            }
+            Task task;
+            // a counted task is in some deque until claimed, so this finds one
+            while (!pop(index, task)) {
+                std::this_thread::yield();
+            }
+            task();
+        }
+    }
+};
+
+inline thread_local const ThreadPool* ThreadPool::currentPool = nullptr;
+inline thread_local size_t ThreadPool::currentWorker = 0;
@@ -4,40 +4,175 @@
 #include <random>
 #include <memory>
 #include <functional>
+#include <vector>
+#include <cstdint>
+#include <stdexcept>
+#include <iterator>
+#include "ThreadPool.h"
+#include "HashOrder.h"
+#include "TreapNodePool.h"
 
-template<typename T>
+// Multiset ordered by 'Compare', with order statistics from subtree counts.
+// Nodes live in a TreapNodePool and refer to each other by 32-bit indices.
+template<typename T, typename Allocator = std::allocator<T>, typename Compare = HashOrder<T>>
 class Treap {
 public:
-    Treap() : rnd(time(nullptr)) {}
+    explicit Treap(const Compare& compare = Compare()) :
+        rnd(time(nullptr)),
+        compare(compare) {}
     Treap(const Treap& other) = delete;
     Treap(Treap&& other) :
         rnd(time(nullptr)),
-        root(move(other.root)) { }
+        compare(other.compare),
+        nodes(std::move(other.nodes)),
+        root(other.root) {
+        other.root = NONE;
+    }
 
     void insert(const T& value) {
-        auto res = split(move(root), std::hash<T>{}(value));
-        NodePtr node(new Node(value, rnd));
-        root = move(merge(move(res.first),
-            merge(move(node), move(res.second))));
+        auto res = split(root, value, true);
+        const uint32_t node = allocate(value);
+        root = merge(res.first, merge(node, res.second));
+    }
+
+    // builds the treap from a sorted range in O(n) with a Cartesian-tree stack
+    template<typename Iterator>
+    static Treap fromSorted(Iterator first, Iterator last,
+                            const Compare& compare = Compare()) {
+        Treap result(compare);
+        result.reserve(std::distance(first, last));
+        std::vector<uint32_t> stack;
+        for (; first != last; ++first) {
+            const uint32_t node = result.allocate(*first);
+            Node& current = result.nodes[node];
+            if (node > 0 && compare(current.value, result.nodes[node - 1].value)) {
+                throw std::invalid_argument("range is not sorted");
+            }
+            uint32_t lastPopped = NONE;
+            while (!stack.empty() && result.nodes[stack.back()].priority < current.priority) {
+                lastPopped = stack.back();
+                stack.pop_back();
+            }
+            current.left = lastPopped;
+            if (!stack.empty()) {
+                result.nodes[stack.back()].right = node;
+            }
+            stack.push_back(node);
+        }
+        if (!stack.empty()) {
+            result.root = stack.front();
+            result.updateAllCounts();
+        }
+        return result;
+    }
+
+    // join-based set operations; the larger subproblems run in parallel.
+    // meant for treaps without duplicates, on equal keys this keeps its own element.
+    // nodes the result leaves out go back to the free list
+
+    void unionWith(const Treap& other) {
+        const uint32_t otherRoot = import(other);
+        root = unite(root, otherRoot, scratch);
+        releaseDropped();
+    }
+
+    void intersectWith(const Treap& other) {
+        const uint32_t otherRoot = import(other);
+        root = intersect(root, otherRoot, scratch);
+        releaseDropped();
     }
 
+    void differenceWith(const Treap& other) {
+        const uint32_t otherRoot = import(other);
+        root = subtract(root, otherRoot, scratch);
+        releaseDropped();
+    }
+
+    // removes every element equivalent to 'value'
     void erase(const T& value) {
-        auto hash = std::hash<T>{}(value);
-        auto firstSplit = split(move(root), hash);
-        auto secondSplit = split(move(firstSplit.first), static_cast<int64_t>(hash) - 1);
-        root = move(merge(move(firstSplit.second), move(secondSplit.first)));
+        auto firstSplit = split(root, value, false);
+        auto secondSplit = split(firstSplit.second, value, true);
+        nodes.release(secondSplit.first);
+        root = merge(firstSplit.first, secondSplit.second);
+    }
+
+    // returns an element equivalent to 'value' or nullptr
+    const T* find(const T& value) const {
+        const T* result = lowerBound(value);
+        if (result && !compare(value, *result)) {
+            return result;
+        }
+        return nullptr;
+    }
+
+    bool contains(const T& value) const {
+        return find(value) != nullptr;
+    }
+
+    // returns the first element not less than 'value' or nullptr
+    const T* lowerBound(const T& value) const {
+        return bound(value, false);
+    }
+
+    // returns the first element greater than 'value' or nullptr
+    const T* upperBound(const T& value) const {
+        return bound(value, true);
+    }
+
+    // returns the k-th (0-based) element in order
+    const T& kth(size_t k) const {
+        if (k >= size()) {
+            throw std::out_of_range("index out of range");
+        }
+        uint32_t node = root;
+        while (true) {
+            const size_t leftCount = getCount(nodes[node].left);
+            if (k < leftCount) {
+                node = nodes[node].left;
+            } else if (k == leftCount) {
+                return nodes[node].value;
+            } else {
+                k -= leftCount + 1;
+                node = nodes[node].right;
+            }
+        }
+    }
+
+    // returns the number of elements less than 'value'
+    size_t rank(const T& value) const {
+        return countBefore(value, false);
+    }
+
+    // returns the number of elements in [from, to]
+    size_t countInRange(const T& from, const T& to) const {
+        if (compare(to, from)) {
+            return 0;
+        }
+        return countBefore(to, true) - countBefore(from, false);
     }
 
     size_t size() const {
-        return root->count;
+        return getCount(root);
+    }
+
+    void reserve(size_t count) {
+        nodes.reserve(count);
+    }
+
+    // moves the elements to the front of a slab of exactly size() nodes,
+    // giving back the memory of free slots
+    void compact() {
+        root = nodes.compact(root);
     }
 
     void clear() {
-        clear(root);
+        nodes.clear();
+        root = NONE;
     }
 
     std::vector<T> toVector() const {
         std::vector<T> result;
+        result.reserve(size());
         inorder(result, root);
         return result;
     }
@@ -45,91 +180,383 @@ public:
     Treap& operator=(const Treap& other) = delete;
 
     Treap& operator=(Treap&& other) {
-        root = move(other.root);
+        compare = other.compare;
+        nodes = std::move(other.nodes);
+        root = other.root;
+        other.root = NONE;
         return *this;
     }
 private:
+    static constexpr uint32_t NONE = UINT32_MAX;
+
     std::mt19937 rnd;
+    Compare compare;
 
     struct Node {
         T value;
-        size_t hashedKey;
-        int64_t priority;
-        uint64_t count;
-        std::unique_ptr<Node> left = nullptr;
-        std::unique_ptr<Node> right = nullptr;
-
-        Node(const T& x, std::mt19937 gen) {
-            value = x;
-            hashedKey = std::hash<T>{}(x);
-            priority = gen();
-            count = 1;
+        uint32_t priority;
+        uint32_t count;
+        uint32_t left;
+        // next free node while the node is on the free list
+        uint32_t right;
+    };
+
+    TreapNodePool<Node, Allocator> nodes;
+    uint32_t root = NONE;
+    // scratch stack of visited nodes, kept to avoid reallocating on every operation
+    std::vector<uint32_t> path;
+
+    // per-thread state of a set operation: the stack of its splits and merges,
+    // and the roots of the subtrees it left out, freed once it is done
+    struct Scratch {
+        std::vector<uint32_t> path;
+        std::vector<uint32_t> dropped;
+    };
+
+    Scratch scratch;
+
+    uint32_t allocate(const T& value) {
+        return nodes.allocate({value, static_cast<uint32_t>(rnd()), 1, NONE, NONE});
+    }
+
+    // whether 'value' is less than 'x' (or not greater if 'orEqual')
+    bool goesLeft(const T& value, const T& x, bool orEqual) const {
+        return orEqual ? !compare(x, value) : compare(value, x);
+    }
+
+    // first element that does not go left of 'value'
+    const T* bound(const T& value, bool orEqual) const {
+        const T* result = nullptr;
+        uint32_t node = root;
+        while (node != NONE) {
+            if (goesLeft(nodes[node].value, value, orEqual)) {
+                node = nodes[node].right;
+            } else {
+                result = &nodes[node].value;
+                node = nodes[node].left;
+            }
         }
+        return result;
+    }
+
+    // number of elements that go left of 'value'
+    size_t countBefore(const T& value, bool orEqual) const {
+        size_t result = 0;
+        uint32_t node = root;
+        while (node != NONE) {
+            if (goesLeft(nodes[node].value, value, orEqual)) {
+                result += getCount(nodes[node].left) + 1;
+                node = nodes[node].right;
+            } else {
+                node = nodes[node].left;
+            }
+        }
+        return result;
+    }
+
+    uint32_t getCount(uint32_t node) const {
+        return node != NONE ? nodes[node].count : 0;
+    }
+
+    void updateCount(uint32_t node) {
+        nodes[node].count = getCount(nodes[node].left) +
+                getCount(nodes[node].right) + 1;
+    }
+
+    // recomputes counts of the nodes on 'stack', deepest first
+    void updatePath(const std::vector<uint32_t>& stack) {
+        for (auto it = stack.rbegin(); it != stack.rend(); ++it) {
+            updateCount(*it);
+        }
+    }
+
+    // top-down: the node with the higher priority is hooked into the result
+    // and the merge continues in its inner subtree
+    uint32_t merge(uint32_t left, uint32_t right) {
+        return merge(left, right, path);
+    }
+
+    uint32_t merge(uint32_t left, uint32_t right, std::vector<uint32_t>& stack) {
+        uint32_t result = NONE;
+        uint32_t* hook = &result;
+        stack.clear();
+        while (left != NONE && right != NONE) {
+            if (nodes[left].priority > nodes[right].priority) {
+                *hook = left;
+                stack.push_back(left);
+                hook = &nodes[left].right;
+                left = nodes[left].right;
+            } else {
+                *hook = right;
+                stack.push_back(right);
+                hook = &nodes[right].left;
+                right = nodes[right].left;
+            }
+        }
+        *hook = left != NONE ? left : right;
+        updatePath(stack);
+        return result;
+    }
+
+    // left part gets keys less than 'x' (or equal to it if 'orEqual').
+    // top-down: every node is hooked to the part it belongs to
+    std::pair<uint32_t, uint32_t> split(uint32_t node, const T& x, bool orEqual) {
+        return split(node, x, orEqual, path);
+    }
+
+    std::pair<uint32_t, uint32_t> split(uint32_t node, const T& x, bool orEqual,
+                                        std::vector<uint32_t>& stack) {
+        uint32_t left = NONE;
+        uint32_t right = NONE;
+        uint32_t* leftHook = &left;
+        uint32_t* rightHook = &right;
+        stack.clear();
+        while (node != NONE) {
+            stack.push_back(node);
+            if (goesLeft(nodes[node].value, x, orEqual)) {
+                *leftHook = node;
+                leftHook = &nodes[node].right;
+                node = nodes[node].right;
+            } else {
+                *rightHook = node;
+                rightHook = &nodes[node].left;
+                node = nodes[node].left;
+            }
+        }
+        *leftHook = NONE;
+        *rightHook = NONE;
+        updatePath(stack);
+        return {left, right};
+    }
+
+    // combined subtree size below which both halves of a set operation stay on
+    // the calling thread: 32K nodes are a few hundred microseconds of splits on
+    // cold nodes, while a pool task costs an allocation and a queue lock
+    static constexpr uint32_t PARALLEL_GRAIN = 1 << 15;
+
+    // counts of every node after the links were set directly
+    void updateAllCounts() {
+        std::vector<uint32_t> order;
+        path.clear();
+        path.push_back(root);
+        while (!path.empty()) {
+            const uint32_t node = path.back();
+            path.pop_back();
+            order.push_back(node);
+            if (nodes[node].left != NONE) {
+                path.push_back(nodes[node].left);
+            }
+            if (nodes[node].right != NONE) {
+                path.push_back(nodes[node].right);
+            }
+        }
+        path = std::move(order);
+        updatePath(path);
+    }
+
+    // copies the nodes of 'other' into this slab, free slots first, returns the new root
+    uint32_t import(const Treap& other) {
+        if (other.root == NONE) {
+            return NONE;
+        }
+        const uint32_t result = nodes.allocate(other.nodes[other.root]);
+        // copies whose children still refer to nodes of 'other'
+        path.clear();
+        path.push_back(result);
+        while (!path.empty()) {
+            const uint32_t copy = path.back();
+            path.pop_back();
+            for (uint32_t Node::*child : {&Node::left, &Node::right}) {
+                if (nodes[copy].*child != NONE) {
+                    const uint32_t childCopy = nodes.allocate(other.nodes[nodes[copy].*child]);
+                    nodes[copy].*child = childCopy;
+                    path.push_back(childCopy);
+                }
+            }
+        }
+        return result;
+    }
+
+    // 'node' and its subtree are freed when the set operation is done
+    static void drop(uint32_t node, Scratch& scratch) {
+        if (node != NONE) {
+            scratch.dropped.push_back(node);
+        }
+    }
+
+    void releaseDropped() {
+        for (uint32_t node : scratch.dropped) {
+            nodes.release(node);
+        }
+        scratch.dropped.clear();
+    }
+
+    struct ThreeWaySplit {
+        uint32_t less;
+        uint32_t equal;
+        uint32_t greater;
     };
 
-    using NodePtr = std::unique_ptr<Node>;
+    ThreeWaySplit splitAround(uint32_t node, const T& x, std::vector<uint32_t>& stack) {
+        auto lessSplit = split(node, x, false, stack);
+        auto equalSplit = split(lessSplit.second, x, true, stack);
+        return {lessSplit.first, equalSplit.first, equalSplit.second};
+    }
 
-    NodePtr root;
+    // join(left, middle, right) for keys of 'left' <= 'middle' <= 'right'
+    uint32_t join(uint32_t left, uint32_t middle, uint32_t right, std::vector<uint32_t>& stack) {
+        return merge(merge(left, middle, stack), right, stack);
+    }
 
-    uint64_t getCount(const NodePtr& node) const {
-        return node ? node->count : 0;
+    uint32_t detach(uint32_t node) {
+        nodes[node].left = NONE;
+        nodes[node].right = NONE;
+        nodes[node].count = 1;
+        return node;
     }
 
-    void updateCount(NodePtr& node) {
-        node->count = getCount(node->left) +
-                getCount(node->right) + 1;
+    // runs 'left' and 'right' on the shared ThreadPool if the subproblem is large enough,
+    // 'left' gets its own scratch since the two may run at the same time
+    template<typename Left, typename Right>
+    void fork(size_t size, Scratch& scratch, Left left, Right right) {
+        if (size < PARALLEL_GRAIN) {
+            left(scratch);
+            right(scratch);
+            return;
+        }
+        Scratch own;
+        ThreadPool::shared().parallelFor(0, 2, 1, [&](size_t from, size_t to) {
+            for (size_t side = from; side < to; ++side) {
+                if (side == 0) {
+                    left(own);
+                } else {
+                    right(scratch);
+                }
+            }
+        });
+        scratch.dropped.insert(scratch.dropped.end(), own.dropped.begin(), own.dropped.end());
     }
 
-    NodePtr merge(NodePtr left, NodePtr right) {
-        if (!left) {
-            return right;
+    // the root with the higher priority becomes the pivot, the other tree is split around it
+    uint32_t unite(uint32_t first, uint32_t second, Scratch& scratch) {
+        if (first == NONE) {
+            return second;
         }
-        if (!right) {
-            return left;
+        if (second == NONE) {
+            return first;
         }
-        if (left->priority > right->priority) {
-            left->right = move(merge(move(left->right), move(right)));
-            updateCount(left);
-            return left;
+        const size_t size = getCount(first) + getCount(second);
+        uint32_t left = NONE;
+        uint32_t right = NONE;
+        uint32_t middle = NONE;
+        if (nodes[first].priority >= nodes[second].priority) {
+            const ThreeWaySplit parts = splitAround(second, nodes[first].value, scratch.path);
+            const uint32_t firstLeft = nodes[first].left;
+            const uint32_t firstRight = nodes[first].right;
+            fork(size, scratch,
+                 [&](Scratch& own) { left = unite(firstLeft, parts.less, own); },
+                 [&](Scratch& own) { right = unite(firstRight, parts.greater, own); });
+            middle = detach(first);
+            drop(parts.equal, scratch);
         } else {
-            right->left = move(merge(move(left), move(right->left)));
-            updateCount(right);
-            return right;
+            const ThreeWaySplit parts = splitAround(first, nodes[second].value, scratch.path);
+            const uint32_t secondLeft = nodes[second].left;
+            const uint32_t secondRight = nodes[second].right;
+            fork(size, scratch,
+                 [&](Scratch& own) { left = unite(parts.less, secondLeft, own); },
+                 [&](Scratch& own) { right = unite(parts.greater, secondRight, own); });
+            if (parts.equal != NONE) {
+                middle = parts.equal;
+                drop(detach(second), scratch);
+            } else {
+                middle = detach(second);
+            }
         }
+        return join(left, middle, right, scratch.path);
     }
 
-    std::pair<NodePtr, NodePtr> split(NodePtr node, size_t x) {
-        if (!node) {
-            return {nullptr, nullptr};
+    uint32_t intersect(uint32_t first, uint32_t second, Scratch& scratch) {
+        if (first == NONE || second == NONE) {
+            drop(first, scratch);
+            drop(second, scratch);
+            return NONE;
         }
-        if (node->hashedKey <= x) {
-            auto res = split(move(node->right), x);
-            node->right = move(res.first);
-            updateCount(node);
-            return {move(node), move(res.second)};
+        const size_t size = getCount(first) + getCount(second);
+        uint32_t left = NONE;
+        uint32_t right = NONE;
+        uint32_t middle = NONE;
+        if (nodes[first].priority >= nodes[second].priority) {
+            const ThreeWaySplit parts = splitAround(second, nodes[first].value, scratch.path);
+            const uint32_t firstLeft = nodes[first].left;
+            const uint32_t firstRight = nodes[first].right;
+            fork(size, scratch,
+                 [&](Scratch& own) { left = intersect(firstLeft, parts.less, own); },
+                 [&](Scratch& own) { right = intersect(firstRight, parts.greater, own); });
+            if (parts.equal != NONE) {
+                middle = detach(first);
+                drop(parts.equal, scratch);
+            } else {
+                drop(detach(first), scratch);
+            }
         } else {
-            auto res = split(move(node->left), x);
-            node->left = move(res.second);
-            updateCount(node);
-            return {move(res.first), move(node)};
+            const ThreeWaySplit parts = splitAround(first, nodes[second].value, scratch.path);
+            const uint32_t secondLeft = nodes[second].left;
+            const uint32_t secondRight = nodes[second].right;
+            fork(size, scratch,
+                 [&](Scratch& own) { left = intersect(parts.less, secondLeft, own); },
+                 [&](Scratch& own) { right = intersect(parts.greater, secondRight, own); });
+            middle = parts.equal;
+            drop(detach(second), scratch);
         }
+        return join(left, middle, right, scratch.path);
     }
 
-    void inorder(std::vector<T>& vector, const NodePtr& nodePtr) const {
-        if (!nodePtr) {
-            return;
+    uint32_t subtract(uint32_t first, uint32_t second, Scratch& scratch) {
+        if (first == NONE || second == NONE) {
+            drop(second, scratch);
+            return first;
         }
-        inorder(vector, nodePtr->left);
-        vector.push_back(nodePtr->value);
-        inorder(vector, nodePtr->right);
+        const size_t size = getCount(first) + getCount(second);
+        uint32_t left = NONE;
+        uint32_t right = NONE;
+        uint32_t middle = NONE;
+        if (nodes[first].priority >= nodes[second].priority) {
+            const ThreeWaySplit parts = splitAround(second, nodes[first].value, scratch.path);
+            const uint32_t firstLeft = nodes[first].left;
+            const uint32_t firstRight = nodes[first].right;
+            fork(size, scratch,
+                 [&](Scratch& own) { left = subtract(firstLeft, parts.less, own); },
+                 [&](Scratch& own) { right = subtract(firstRight, parts.greater, own); });
+            if (parts.equal == NONE) {
+                middle = detach(first);
+            } else {
+                drop(detach(first), scratch);
+                drop(parts.equal, scratch);
+            }
+        } else {
+            const ThreeWaySplit parts = splitAround(first, nodes[second].value, scratch.path);
+            const uint32_t secondLeft = nodes[second].left;
+            const uint32_t secondRight = nodes[second].right;
+            fork(size, scratch,
+                 [&](Scratch& own) { left = subtract(parts.less, secondLeft, own); },
+                 [&](Scratch& own) { right = subtract(parts.greater, secondRight, own); });
+            drop(detach(second), scratch);
+            drop(parts.equal, scratch);
+        }
+        return join(left, middle, right, scratch.path);
     }
 
-    void clear(NodePtr& nodePtr) {
-        if (!nodePtr) {
-            return;
+    void inorder(std::vector<T>& vector, uint32_t node) const {
+        std::vector<uint32_t> stack;
+        while (node != NONE || !stack.empty()) {
+            while (node != NONE) {
+                stack.push_back(node);
+                node = nodes[node].left;
+            }
+            node = stack.back();
+            stack.pop_back();
+            vector.push_back(nodes[node].value);
+            node = nodes[node].right;
         }
-        clear(nodePtr->left);
-        clear(nodePtr->right);
-        nodePtr.reset();
     }
 };
@@ -0,0 +1,130 @@
+#pragma once
+#include <memory>
+#include <vector>
+#include <cstdint>
+#include <stdexcept>
+
+// Slab of treap nodes shared by Treap and ImplicitTreap. Nodes refer to each
+// other by 32-bit indices in 'left' and 'right'; a released node is chained into
+// an intrusive free list through its 'right' field and reused by the next
+// allocate(). clear() drops the whole slab at once.
+// 'Allocator' is rebound to the node type and used for the slab.
+template<typename Node, typename Allocator = std::allocator<Node>>
+class TreapNodePool {
+public:
+    static constexpr uint32_t NONE = UINT32_MAX;
+
+    TreapNodePool() { }
+    TreapNodePool(const TreapNodePool& other) = delete;
+    TreapNodePool(TreapNodePool&& other) :
+        nodes(std::move(other.nodes)),
+        freeHead(other.freeHead) {
+        other.clear();
+    }
+
+    Node& operator[](uint32_t index) {
+        return nodes[index];
+    }
+
+    const Node& operator[](uint32_t index) const {
+        return nodes[index];
+    }
+
+    // stores 'node' in a free slot, returns its index
+    uint32_t allocate(const Node& node) {
+        if (freeHead != NONE) {
+            const uint32_t index = freeHead;
+            freeHead = nodes[index].right;
+            nodes[index] = node;
+            return index;
+        }
+        if (nodes.size() >= NONE) {
+            throw std::length_error("treap is full");
+        }
+        nodes.push_back(node);
+        return static_cast<uint32_t>(nodes.size() - 1);
+    }
+
+    // puts the whole subtree on the free list
+    void release(uint32_t node) {
+        if (node == NONE) {
+            return;
+        }
+        stack.clear();
+        stack.push_back(node);
+        while (!stack.empty()) {
+            const uint32_t current = stack.back();
+            stack.pop_back();
+            pushChildren(current);
+            nodes[current].right = freeHead;
+            freeHead = current;
+        }
+    }
+
+    // moves the nodes reachable from 'root' to the front of a new slab in
+    // preorder and drops every other slot, returns the new index of 'root'.
+    // O(slab), so it is only done on request
+    uint32_t compact(uint32_t root) {
+        std::vector<Node, NodeAllocator> live(nodes.get_allocator());
+        stack.clear();
+        if (root != NONE) {
+            live.push_back(nodes[root]);
+            stack.push_back(0);
+        }
+        while (!stack.empty()) {
+            const uint32_t copy = stack.back();
+            stack.pop_back();
+            for (uint32_t Node::*child : {&Node::left, &Node::right}) {
+                if (live[copy].*child != NONE) {
+                    live.push_back(nodes[live[copy].*child]);
+                    live[copy].*child = static_cast<uint32_t>(live.size() - 1);
+                    stack.push_back(live[copy].*child);
+                }
+            }
+        }
+        live.shrink_to_fit();
+        nodes = std::move(live);
+        freeHead = NONE;
+        return root != NONE ? 0 : NONE;
+    }
+
+    // number of slots, free ones included
+    size_t size() const {
+        return nodes.size();
+    }
+
+    void reserve(size_t count) {
+        nodes.reserve(count);
+    }
+
+    void clear() {
+        nodes.clear();
+        freeHead = NONE;
+    }
+
+    TreapNodePool& operator=(const TreapNodePool& other) = delete;
+
+    TreapNodePool& operator=(TreapNodePool&& other) {
+        nodes = std::move(other.nodes);
+        freeHead = other.freeHead;
+        other.clear();
+        return *this;
+    }
+
+private:
+    using NodeAllocator = typename std::allocator_traits<Allocator>::template rebind_alloc<Node>;
+
+    std::vector<Node, NodeAllocator> nodes;
+    uint32_t freeHead = NONE;
+    // scratch stack of the traversals, kept to avoid reallocating on every release
+    std::vector<uint32_t> stack;
+
+    void pushChildren(uint32_t node) {
+        if (nodes[node].left != NONE) {
+            stack.push_back(nodes[node].left);
+        }
+        if (nodes[node].right != NONE) {
+            stack.push_back(nodes[node].right);
+        }
+    }
+};
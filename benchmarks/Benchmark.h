@@ -0,0 +1,37 @@
+#pragma once
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <cstdlib>
+
+/* Helpers shared by the benchmark programs in this directory.
+   Every program is one translation unit built from the repository root:
+
+   g++ -std=c++17 -O2 -march=native -pthread -I. benchmarks/<Name>.cpp -o bench
+   ./bench [scale]
+
+   'scale' divides the default sizes, so big runs can be shrunk on small machines.
+ */
+
+// wall time of one call of 'function' in seconds
+template<typename Function>
+double measure(Function function) {
+    const auto start = std::chrono::steady_clock::now();
+    function();
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+// the optional divisor of the default sizes from the command line.
+// also makes stdout line buffered, so rows show up as they are measured
+inline size_t scaleArgument(int argc, char** argv) {
+    std::setvbuf(stdout, nullptr, _IOLBF, 0);
+    const long scale = argc > 1 ? std::atol(argv[1]) : 1;
+    return scale > 0 ? static_cast<size_t>(scale) : 1;
+}
+
+// keeps a result alive so the measured work is not optimized out
+template<typename T>
+void keep(const T& value) {
+    asm volatile("" : : "g"(&value) : "memory");
+}
@@ -0,0 +1,77 @@
+#include <vector>
+#include <cstdint>
+#include <algorithm>
+#include "Benchmark.h"
+#include "SparseSegmentTree2D.h"
+#include "CompressedSegmentTree2D.h"
+
+// CompressedSegmentTree2D against SparseSegmentTree2D on a 10^6 x 10^6 grid:
+// k random points are loaded, then 10^5 random point updates and rectangle sums.
+// SparseSegmentTree2D only runs on the smaller sizes, past that its pools
+// would not fit in memory
+using Compressed = CompressedSegmentTree2D<int32_t, SumMonoid<int32_t>>;
+using Sparse = SparseSegmentTree2D<int32_t, SumMonoid<int32_t>>;
+
+const size_t SIDE = 1000000;
+
+template<typename Tree>
+void measureOperations(Tree& tree, const std::vector<Compressed::Point>& points, size_t count,
+                       double& updateTime, double& queryTime) {
+    std::mt19937 random(2);
+    int64_t checksum = 0;
+    updateTime = measure([&]() {
+        for (size_t i = 0; i < count; i++) {
+            const Compressed::Point& point = points[random() % points.size()];
+            tree.update(point.column, point.row, static_cast<int32_t>(random() % 100));
+        }
+    }) / count;
+    queryTime = measure([&]() {
+        for (size_t i = 0; i < count; i++) {
+            size_t columns[2] = {random() % SIDE, random() % SIDE};
+            size_t rows[2] = {random() % SIDE, random() % SIDE};
+            std::sort(columns, columns + 2);
+            std::sort(rows, rows + 2);
+            checksum += tree.query(columns[0], columns[1], rows[0], rows[1]);
+        }
+    }) / count;
+    keep(checksum);
+}
+
+int main(int argc, char** argv) {
+    const size_t scale = scaleArgument(argc, argv);
+    const size_t count = 100000 / scale;
+    std::printf("%10s %12s %10s %12s %10s %10s\n", "points", "tree", "build, s", "bytes/point", "ns/update", "ns/query");
+    for (size_t k : {100000, 1000000, 10000000}) {
+        k /= scale;
+        std::mt19937 random(1);
+        std::vector<Compressed::Point> points(k);
+        for (Compressed::Point& point : points) {
+            point = {random() % SIDE, random() % SIDE, static_cast<int32_t>(random() % 100)};
+        }
+        double updateTime, queryTime;
+        if (k <= 100000 / scale) {
+            Sparse* sparse = nullptr;
+            const double buildTime = measure([&]() {
+                sparse = new Sparse(SIDE, SIDE);
+                for (const Compressed::Point& point : points) {
+                    sparse->update(point.column, point.row, point.value);
+                }
+            });
+            measureOperations(*sparse, points, count, updateTime, queryTime);
+            // column nodes are three 32-bit links, row nodes a value and two links
+            const double bytes = sparse->nodesCount() * 12.0;
+            std::printf("%10zu %12s %10.2f %12.0f %10.0f %10.0f\n", k, "sparse", buildTime, bytes / k,
+                        updateTime * 1e9, queryTime * 1e9);
+            delete sparse;
+        }
+        Compressed* compressed = nullptr;
+        const double buildTime = measure([&]() { compressed = new Compressed(SIDE, SIDE, points); });
+        measureOperations(*compressed, points, count, updateTime, queryTime);
+        const double bytes = compressed->entriesCount() * (sizeof(uint32_t) + 2 * sizeof(int32_t)) +
+                             2.0 * k * sizeof(size_t);
+        std::printf("%10zu %12s %10.2f %12.0f %10.0f %10.0f\n", k, "compressed", buildTime, bytes / k,
+                    updateTime * 1e9, queryTime * 1e9);
+        delete compressed;
+    }
+    return 0;
+}
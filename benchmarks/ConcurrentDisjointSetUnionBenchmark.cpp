@@ -0,0 +1,59 @@
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <cstdint>
+#include "Benchmark.h"
+#include "DenseDisjointSetUnion.h"
+#include "ConcurrentDisjointSetUnion.h"
+
+// thread scaling of ConcurrentDisjointSetUnion against a DenseDisjointSetUnion
+// behind one global mutex, the setup it replaces. Every thread takes an equal
+// slice of the random edges and calls unionSets per edge
+template<typename Union>
+double run(size_t threads, size_t edges, Union unionSets) {
+    return measure([&]() {
+        std::vector<std::thread> workers;
+        for (size_t part = 0; part < threads; part++) {
+            workers.emplace_back([&, part]() {
+                for (size_t i = edges * part / threads; i < edges * (part + 1) / threads; i++) {
+                    unionSets(i);
+                }
+            });
+        }
+        for (std::thread& worker : workers) {
+            worker.join();
+        }
+    });
+}
+
+int main(int argc, char** argv) {
+    const size_t scale = scaleArgument(argc, argv);
+    const size_t n = 4000000 / scale;
+    const size_t edges = 8000000 / scale;
+    std::mt19937 random(1);
+    std::vector<std::pair<uint32_t, uint32_t>> pairs(edges);
+    for (auto& pair : pairs) {
+        pair = {static_cast<uint32_t>(random() % n), static_cast<uint32_t>(random() % n)};
+    }
+    std::printf("%d hardware threads, %zu elements, %zu edges\n",
+                std::thread::hardware_concurrency(), n, edges);
+    std::printf("%8s %12s %14s %10s\n", "threads", "mutex, s", "lock-free, s", "speedup");
+    for (size_t threads : {1, 2, 4, 8, 16, 32, 64}) {
+        DenseDisjointSetUnion locked(n);
+        std::mutex mutex;
+        const double lockedTime = run(threads, edges, [&](size_t i) {
+            std::lock_guard<std::mutex> guard(mutex);
+            locked.unionSets(pairs[i].first, pairs[i].second);
+        });
+        ConcurrentDisjointSetUnion concurrent(n);
+        const double concurrentTime = run(threads, edges, [&](size_t i) {
+            concurrent.unionSets(pairs[i].first, pairs[i].second);
+        });
+        if (concurrent.components().sizes.size() != locked.components().sizes.size()) {
+            std::printf("component counts differ\n");
+            return 1;
+        }
+        std::printf("%8zu %12.3f %14.3f %9.2fx\n", threads, lockedTime, concurrentTime, lockedTime / concurrentTime);
+    }
+    return 0;
+}
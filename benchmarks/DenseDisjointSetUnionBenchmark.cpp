@@ -0,0 +1,46 @@
+#include <vector>
+#include <cstdint>
+#include "Benchmark.h"
+#include "DisjointSetUnion.h"
+#include "DenseDisjointSetUnion.h"
+
+// DenseDisjointSetUnion against the map-backed DisjointSetUnion:
+// n makeSets, n random unions, then n finds over 0..n-1 ids
+int main(int argc, char** argv) {
+    const size_t scale = scaleArgument(argc, argv);
+    std::printf("%12s %12s %12s %10s\n", "elements", "map, s", "dense, s", "speedup");
+    for (size_t n : {1000000, 10000000, 30000000}) {
+        n /= scale;
+        std::mt19937 random(1);
+        std::vector<std::pair<uint32_t, uint32_t>> pairs(n);
+        for (auto& pair : pairs) {
+            pair = {static_cast<uint32_t>(random() % n), static_cast<uint32_t>(random() % n)};
+        }
+        size_t checksum = 0;
+        const double mapTime = measure([&]() {
+            DisjointSetUnion<uint32_t> sets;
+            for (uint32_t i = 0; i < n; ++i) {
+                sets.makeSet(i);
+            }
+            for (const auto& pair : pairs) {
+                sets.unionSets(pair.first, pair.second);
+            }
+            for (uint32_t i = 0; i < n; ++i) {
+                checksum += sets.findSet(i);
+            }
+        });
+        const double denseTime = measure([&]() {
+            DenseDisjointSetUnion sets;
+            sets.makeSets(n);
+            for (const auto& pair : pairs) {
+                sets.unionSets(pair.first, pair.second);
+            }
+            for (uint32_t i = 0; i < n; ++i) {
+                checksum += sets.findSet(i);
+            }
+        });
+        keep(checksum);
+        std::printf("%12zu %12.3f %12.3f %9.1fx\n", n, mapTime, denseTime, mapTime / denseTime);
+    }
+    return 0;
+}
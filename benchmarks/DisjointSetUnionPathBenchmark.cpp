@@ -0,0 +1,47 @@
+#include <vector>
+#include <cstdint>
+#include "Benchmark.h"
+#include "DisjointSetUnion.h"
+#include "baseline/DisjointSetUnion.h"
+
+// path compression against the baseline findSet, which compresses only a local copy:
+// unions in binomial order give every tree the deepest shape union by rank allows
+// (log2 n levels), then every element is found 'rounds' times
+template<typename Sets>
+double run(size_t n, size_t rounds, size_t& checksum) {
+    return measure([&]() {
+        Sets sets;
+        for (uint32_t i = 0; i < n; ++i) {
+            sets.makeSet(i);
+        }
+        for (size_t step = 1; step < n; step *= 2) {
+            for (size_t i = 0; i + step < n; i += 2 * step) {
+                sets.unionSets(static_cast<uint32_t>(i), static_cast<uint32_t>(i + step));
+            }
+        }
+        for (size_t round = 0; round < rounds; ++round) {
+            for (size_t i = n; i-- > 0;) {
+                checksum += sets.findSet(static_cast<uint32_t>(i));
+            }
+        }
+    });
+}
+
+int main(int argc, char** argv) {
+    const size_t scale = scaleArgument(argc, argv);
+    const size_t rounds = 8;
+    std::printf("%12s %8s %14s %14s %10s\n", "elements", "depth", "baseline, s", "compressed, s", "speedup");
+    for (size_t n : {1 << 16, 1 << 20, 1 << 23}) {
+        n /= scale;
+        size_t depth = 0;
+        while ((size_t(1) << depth) < n) {
+            ++depth;
+        }
+        size_t checksum = 0;
+        const double baselineTime = run<baseline::DisjointSetUnion<uint32_t>>(n, rounds, checksum);
+        const double compressedTime = run<DisjointSetUnion<uint32_t>>(n, rounds, checksum);
+        keep(checksum);
+        std::printf("%12zu %8zu %14.3f %14.3f %9.1fx\n", n, depth, baselineTime, compressedTime, baselineTime / compressedTime);
+    }
+    return 0;
+}
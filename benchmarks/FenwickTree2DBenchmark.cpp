@@ -0,0 +1,76 @@
+#include <vector>
+#include <cstdint>
+#include <algorithm>
+#include "Benchmark.h"
+#include "FenwickTree2D.h"
+#include "SegmentTree2D.h"
+
+// FenwickTree2D against SegmentTree2D on sums, from tiny to 4096 x 4096 grids:
+// build from a matrix, then a mix of point updates and rectangle queries.
+// the share of updates in the mix is the first column
+struct Operation {
+    bool isUpdate;
+    size_t fromColumn;
+    size_t toColumn;
+    size_t fromRow;
+    size_t toRow;
+    int64_t value;
+};
+
+template<typename Tree>
+double run(Tree& tree, const std::vector<Operation>& operations, int64_t& checksum) {
+    return measure([&]() {
+        for (const Operation& operation : operations) {
+            if (operation.isUpdate) {
+                tree.update(operation.fromColumn, operation.fromRow, operation.value);
+            } else {
+                checksum += tree.query(operation.fromColumn, operation.toColumn,
+                                       operation.fromRow, operation.toRow);
+            }
+        }
+    });
+}
+
+int main(int argc, char** argv) {
+    const size_t scale = scaleArgument(argc, argv);
+    const size_t count = 1000000 / scale;
+    std::printf("%8s %8s %12s %12s %12s %12s %10s\n", "side", "updates", "fenwick, s", "segment, s",
+                "fenwick, ns", "segment, ns", "speedup");
+    for (size_t side : {16, 64, 256, 1024, 4096}) {
+        std::mt19937 random(1);
+        std::vector<std::vector<int64_t>> matrix(side, std::vector<int64_t>(side));
+        for (auto& column : matrix) {
+            for (int64_t& value : column) {
+                value = random() % 1000;
+            }
+        }
+        FenwickTree2D<int64_t> fenwick(std::vector<std::vector<int64_t>>{});
+        SegmentTree2D<int64_t, SumMonoid<int64_t>> segment(std::vector<std::vector<int64_t>>{});
+        const double fenwickBuild = measure([&]() { fenwick = FenwickTree2D<int64_t>(matrix); });
+        const double segmentBuild = measure([&]() {
+            segment = SegmentTree2D<int64_t, SumMonoid<int64_t>>(matrix);
+        });
+        for (const size_t percent : {10, 50, 90}) {
+            std::vector<Operation> operations(count);
+            for (Operation& operation : operations) {
+                size_t columns[2] = {random() % side, random() % side};
+                size_t rows[2] = {random() % side, random() % side};
+                std::sort(columns, columns + 2);
+                std::sort(rows, rows + 2);
+                operation = {random() % 100 < percent, columns[0], columns[1], rows[0], rows[1],
+                             static_cast<int64_t>(random() % 1000)};
+            }
+            int64_t fenwickSum = 0;
+            int64_t segmentSum = 0;
+            const double fenwickTime = run(fenwick, operations, fenwickSum);
+            const double segmentTime = run(segment, operations, segmentSum);
+            if (fenwickSum != segmentSum) {
+                std::printf("results differ\n");
+                return 1;
+            }
+            std::printf("%8zu %7zu%% %12.3f %12.3f %12.0f %12.0f %9.2fx\n", side, percent, fenwickBuild, segmentBuild,
+                        fenwickTime * 1e9 / count, segmentTime * 1e9 / count, segmentTime / fenwickTime);
+        }
+    }
+    return 0;
+}
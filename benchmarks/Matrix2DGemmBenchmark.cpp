@@ -0,0 +1,83 @@
+#include <vector>
+#include <cstdint>
+#include "Benchmark.h"
+#include "Matrix2D.h"
+#include "baseline/Matrix2D.h"
+
+// the packed, cache-blocked operator* against the baseline i-j-k loop over at(),
+// in GFLOP/s (2 n^3 operations per product) for every element type with a
+// SIMD kernel. The shared pool is shrunk to the calling thread, so this is
+// the single-core kernel; the baseline stops at 1024, where it already takes seconds
+template<typename Matrix, typename T>
+Matrix randomMatrix(size_t side, std::mt19937& random) {
+    Matrix matrix(side, side);
+    for (size_t i = 0; i < side; i++) {
+        for (size_t j = 0; j < side; j++) {
+            matrix.at(i, j) = static_cast<T>(random() % 16);
+        }
+    }
+    return matrix;
+}
+
+// best GFLOP/s of enough products to run for about a second; 'checksum'
+// gets the sum of the product's elements
+template<typename Matrix, typename T>
+double gflops(size_t side, double& checksum) {
+    std::mt19937 random(1);
+    const Matrix a = randomMatrix<Matrix, T>(side, random);
+    const Matrix b = randomMatrix<Matrix, T>(side, random);
+    const double operations = 2.0 * side * side * side;
+    double best = 0;
+    double total = 0;
+    Matrix product;
+    for (size_t round = 0; round < 3 || (total < 1 && round < 100); round++) {
+        const double time = measure([&]() {
+            product = a * b;
+        });
+        total += time;
+        best = std::max(best, operations / time * 1e-9);
+        if (time > 3) {
+            break;
+        }
+    }
+    checksum = 0;
+    for (size_t i = 0; i < side; i++) {
+        for (size_t j = 0; j < side; j++) {
+            checksum += static_cast<double>(product.at(i, j));
+        }
+    }
+    return best;
+}
+
+template<typename T>
+void run(const char* type, size_t side, bool withBaseline) {
+    double checksum = 0;
+    const double flat = gflops<Matrix2D<T>, T>(side, checksum);
+    const double flatChecksum = checksum;
+    if (withBaseline) {
+        const double baseline = gflops<baseline::Matrix2D<T>, T>(side, checksum);
+        std::printf("%8s %6zu %10.3f %10.3f %9.1fx %s\n", type, side, baseline, flat, flat / baseline,
+                    checksum == flatChecksum ? "" : "checksum mismatch");
+    } else {
+        std::printf("%8s %6zu %10s %10.3f %10s\n", type, side, "-", flat, "");
+    }
+    keep(flatChecksum);
+}
+
+int main(int argc, char** argv) {
+    const size_t scale = scaleArgument(argc, argv);
+    ThreadPool::shared().resize(1);
+    std::printf("double kernel %zu x %zu, float kernel %zu x %zu\n",
+                Gemm::kernelChoice<double>().mr, Gemm::kernelChoice<double>().nr,
+                Gemm::kernelChoice<float>().mr, Gemm::kernelChoice<float>().nr);
+    std::printf("%8s %6s %10s %10s %10s\n", "type", "side", "baseline", "blocked", "speedup");
+    for (size_t side : {64, 128, 256, 512, 1024, 2048}) {
+        side /= scale;
+        const bool withBaseline = side <= 1024 / scale;
+        run<float>("float", side, withBaseline);
+        run<double>("double", side, withBaseline);
+        run<int32_t>("int32", side, withBaseline);
+        run<int64_t>("int64", side, withBaseline);
+    }
+    return 0;
+}
@@ -0,0 +1,110 @@
+#include <vector>
+#include <cstdint>
+#include "Benchmark.h"
+#include "Matrix2D.h"
+#include "baseline/Matrix2D.h"
+
+// the flat row-major Matrix2D against the baseline vector of vectors on the
+// element-wise operations: a + b, a - b, a * 2, the fused a + b - c, and full
+// sweeps through at() by rows and by columns. The shared pool is shrunk to the
+// calling thread, so only the layout and the expressions differ.
+// the column sweep steps a whole row at a time: with power-of-two sides the
+// flat buffer maps every step to the same cache sets, while the separately
+// allocated rows of the baseline are skewed by the allocator headers
+template<typename Matrix>
+void fill(Matrix& matrix, size_t side, std::mt19937& random) {
+    for (size_t i = 0; i < side; i++) {
+        for (size_t j = 0; j < side; j++) {
+            matrix.at(i, j) = random() % 1000 / 8.0;
+        }
+    }
+}
+
+template<typename Matrix>
+double rowSweep(const Matrix& matrix, size_t side) {
+    double sum = 0;
+    for (size_t i = 0; i < side; i++) {
+        for (size_t j = 0; j < side; j++) {
+            sum += matrix.at(i, j);
+        }
+    }
+    return sum;
+}
+
+template<typename Matrix>
+double columnSweep(const Matrix& matrix, size_t side) {
+    double sum = 0;
+    for (size_t j = 0; j < side; j++) {
+        for (size_t i = 0; i < side; i++) {
+            sum += matrix.at(i, j);
+        }
+    }
+    return sum;
+}
+
+// ns per element of every operation, the checksum keeps both sides honest
+template<typename Matrix>
+void run(const char* name, size_t side, size_t rounds) {
+    std::mt19937 random(1);
+    Matrix a(side, side), b(side, side), c(side, side);
+    fill(a, side, random);
+    fill(b, side, random);
+    fill(c, side, random);
+    double checksum = 0;
+    double times[6];
+    const double elements = static_cast<double>(side) * side * rounds;
+    times[0] = measure([&]() {
+        for (size_t round = 0; round < rounds; round++) {
+            Matrix result = a + b;
+            checksum += result.at(round % side, 0);
+        }
+    });
+    times[1] = measure([&]() {
+        for (size_t round = 0; round < rounds; round++) {
+            Matrix result = a - b;
+            checksum += result.at(round % side, 0);
+        }
+    });
+    times[2] = measure([&]() {
+        for (size_t round = 0; round < rounds; round++) {
+            Matrix result = a * 2.0;
+            checksum += result.at(round % side, 0);
+        }
+    });
+    times[3] = measure([&]() {
+        for (size_t round = 0; round < rounds; round++) {
+            Matrix result = a + b - c;
+            checksum += result.at(round % side, 0);
+        }
+    });
+    times[4] = measure([&]() {
+        for (size_t round = 0; round < rounds; round++) {
+            checksum += rowSweep(a, side);
+        }
+    });
+    times[5] = measure([&]() {
+        for (size_t round = 0; round < rounds; round++) {
+            checksum += columnSweep(a, side);
+        }
+    });
+    keep(checksum);
+    std::printf("%6zu %9s", side, name);
+    for (double time : times) {
+        std::printf(" %8.2f", time * 1e9 / elements);
+    }
+    std::printf(" %16.0f\n", checksum);
+}
+
+int main(int argc, char** argv) {
+    const size_t scale = scaleArgument(argc, argv);
+    ThreadPool::shared().resize(1);
+    std::printf("ns per element\n%6s %9s %8s %8s %8s %8s %8s %8s %16s\n", "side", "matrix",
+                "a+b", "a-b", "a*2", "a+b-c", "rows", "columns", "checksum");
+    for (size_t side : {256, 1024, 4096}) {
+        side /= scale;
+        const size_t rounds = std::max<size_t>(1, (1u << 26) / (side * side));
+        run<baseline::Matrix2D<double>>("baseline", side, rounds);
+        run<Matrix2D<double>>("flat", side, rounds);
+    }
+    return 0;
+}
@@ -0,0 +1,71 @@
+#include <vector>
+#include <thread>
+#include <cstdint>
+#include <algorithm>
+#include "Benchmark.h"
+#include "Matrix2D.h"
+
+// strong scaling of the Matrix2D operations on ThreadPool::shared(): fixed
+// problems timed at 1, 2, 4, ... threads through ThreadPool::resize, up to
+// the number of cores (and at least 8, so oversubscription shows up too).
+// multiply is a 2048 x 2048 double product, pow raises a 512 x 512 matrix to
+// the 16th power, add is a + b - c over 4096 x 4096 doubles
+template<typename Function>
+double best(Function function) {
+    double time = measure(function);
+    for (int round = 0; round < 2; round++) {
+        time = std::min(time, measure(function));
+    }
+    return time;
+}
+
+Matrix2D<double> randomMatrix(size_t side, std::mt19937& random, double scale) {
+    Matrix2D<double> matrix(side, side);
+    for (size_t i = 0; i < side; i++) {
+        for (size_t j = 0; j < side; j++) {
+            matrix(i, j) = (random() % 1000) * scale;
+        }
+    }
+    return matrix;
+}
+
+int main(int argc, char** argv) {
+    const size_t scale = scaleArgument(argc, argv);
+    const size_t multiplySide = 2048 / scale;
+    const size_t powSide = 512 / scale;
+    const size_t addSide = 4096 / scale;
+    std::mt19937 random(1);
+    const Matrix2D<double> a = randomMatrix(multiplySide, random, 1e-3);
+    const Matrix2D<double> b = randomMatrix(multiplySide, random, 1e-3);
+    // scaled so the 16th power neither overflows nor vanishes
+    const Matrix2D<double> base = randomMatrix(powSide, random, 2e-3 / powSide);
+    const Matrix2D<double> x = randomMatrix(addSide, random, 1.0);
+    const Matrix2D<double> y = randomMatrix(addSide, random, 1.0);
+    const Matrix2D<double> z = randomMatrix(addSide, random, 1.0);
+    const size_t cores = std::max(1u, std::thread::hardware_concurrency());
+    std::printf("%zu hardware threads\n", cores);
+    std::printf("%8s %12s %8s %12s %8s %12s %8s %14s\n", "threads", "multiply, s", "speedup",
+                "pow, s", "speedup", "add, s", "speedup", "checksum");
+    double first[3] = {0, 0, 0};
+    for (size_t threads = 1; threads <= std::max<size_t>(cores, 8); threads *= 2) {
+        ThreadPool::shared().resize(threads);
+        double checksum = 0;
+        const double times[3] = {
+            best([&]() { checksum += (a * b)(multiplySide / 2, multiplySide / 3); }),
+            best([&]() { checksum += base.pow(16)(powSide / 2, powSide / 3); }),
+            best([&]() {
+                Matrix2D<double> result = x + y - z;
+                checksum += result(addSide / 2, addSide / 3);
+            })
+        };
+        std::printf("%8zu", threads);
+        for (int i = 0; i < 3; i++) {
+            if (threads == 1) {
+                first[i] = times[i];
+            }
+            std::printf(" %12.3f %7.2fx", times[i], first[i] / times[i]);
+        }
+        std::printf(" %14.6g\n", checksum);
+    }
+    return 0;
+}
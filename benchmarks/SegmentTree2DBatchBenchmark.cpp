@@ -0,0 +1,79 @@
+#include <vector>
+#include <thread>
+#include <cstdint>
+#include <algorithm>
+#include "Benchmark.h"
+#include "SegmentTree2D.h"
+
+// throughput of updateBatch against one update() per point, and of queryBatch
+// on 1..N pool threads against one query() per rectangle, on a sum over a
+// 4096 x 4096 grid with batches of 10^5 as in one frame
+using Tree = SegmentTree2D<int, SumMonoid<int>>;
+
+int main(int argc, char** argv) {
+    const size_t scale = scaleArgument(argc, argv);
+    const size_t side = 4096 / scale;
+    const size_t batch = 100000 / scale;
+    const size_t frames = 10;
+    std::mt19937 random(1);
+    std::vector<std::vector<int>> matrix(side, std::vector<int>(side));
+    for (auto& column : matrix) {
+        for (int& value : column) {
+            value = random() % 1000;
+        }
+    }
+    Tree single(matrix);
+    Tree batched(matrix);
+    std::vector<std::vector<Tree::PointUpdate>> updates(frames);
+    for (auto& frame : updates) {
+        for (size_t i = 0; i < batch; i++) {
+            frame.push_back({random() % side, random() % side, static_cast<int>(random() % 1000)});
+        }
+    }
+    std::vector<Tree::RectangleQuery> queries;
+    for (size_t i = 0; i < batch; i++) {
+        size_t columns[2] = {random() % side, random() % side};
+        size_t rows[2] = {random() % side, random() % side};
+        std::sort(columns, columns + 2);
+        std::sort(rows, rows + 2);
+        queries.push_back({columns[0], columns[1], rows[0], rows[1]});
+    }
+
+    std::printf("%zu x %zu grid, %zu frames of %zu updates\n", side, side, frames, batch);
+    const double singleTime = measure([&]() {
+        for (const auto& frame : updates) {
+            for (const auto& update : frame) {
+                single.update(update.column, update.row, update.value);
+            }
+        }
+    });
+    const double batchTime = measure([&]() {
+        for (const auto& frame : updates) {
+            batched.updateBatch(frame);
+        }
+    });
+    std::printf("%-24s %12.2f M updates/s\n", "update() per point", frames * batch / singleTime / 1e6);
+    std::printf("%-24s %12.2f M updates/s\n", "updateBatch", frames * batch / batchTime / 1e6);
+
+    std::printf("%u hardware threads, batches of %zu queries\n", std::thread::hardware_concurrency(), batch);
+    std::vector<int> expected(queries.size());
+    const double queryTime = measure([&]() {
+        for (size_t i = 0; i < queries.size(); i++) {
+            expected[i] = batched.query(queries[i].fromColumn, queries[i].toColumn,
+                                        queries[i].fromRow, queries[i].toRow);
+        }
+    });
+    std::printf("%-24s %12.2f M queries/s\n", "query() per rectangle", queries.size() / queryTime / 1e6);
+    const size_t maxThreads = std::max(4u, std::thread::hardware_concurrency());
+    for (size_t threads = 1; threads <= maxThreads; threads *= 2) {
+        ThreadPool::shared().resize(threads);
+        std::vector<int> result;
+        const double time = measure([&]() { result = batched.queryBatch(queries); });
+        if (result != expected) {
+            std::printf("queryBatch differs from query()\n");
+            return 1;
+        }
+        std::printf("queryBatch, %2zu threads    %12.2f M queries/s\n", threads, queries.size() / time / 1e6);
+    }
+    return 0;
+}
@@ -0,0 +1,76 @@
+#include <vector>
+#include <cstdint>
+#include <algorithm>
+#include "Benchmark.h"
+#include "SegmentTree2D.h"
+#include "baseline/SegmentTree2D.h"
+
+// the flat bottom-up SegmentTree2D against the baseline recursive one on a
+// sum over a 4096 x 4096 grid: build, random point updates, random rectangles.
+// the new tree runs once with the baseline's function pointer and once with
+// the inlined SumMonoid
+int sum(const int& a, const int& b) {
+    return a + b;
+}
+
+struct Operations {
+    std::vector<SegmentTree2D<int>::PointUpdate> updates;
+    std::vector<SegmentTree2D<int>::RectangleQuery> queries;
+};
+
+template<typename Tree, typename Make>
+void run(const char* name, size_t side, size_t cellBytes, const Operations& operations, Make make) {
+    int64_t checksum = 0;
+    Tree* tree = nullptr;
+    const double buildTime = measure([&]() { tree = make(); });
+    const double updateTime = measure([&]() {
+        for (const auto& update : operations.updates) {
+            tree->update(update.column, update.row, update.value);
+        }
+    });
+    const double queryTime = measure([&]() {
+        for (const auto& query : operations.queries) {
+            checksum += tree->query(query.fromColumn, query.toColumn, query.fromRow, query.toRow);
+        }
+    });
+    delete tree;
+    keep(checksum);
+    std::printf("%-22s %8.2f %10zu %12.0f %12.0f %16lld\n", name, buildTime, side * side * cellBytes >> 20,
+                updateTime * 1e9 / operations.updates.size(), queryTime * 1e9 / operations.queries.size(),
+                static_cast<long long>(checksum));
+}
+
+int main(int argc, char** argv) {
+    const size_t scale = scaleArgument(argc, argv);
+    const size_t side = 4096 / scale;
+    const size_t count = 1000000 / scale;
+    std::mt19937 random(1);
+    std::vector<std::vector<int>> matrix(side, std::vector<int>(side));
+    for (auto& column : matrix) {
+        for (int& value : column) {
+            value = random() % 1000;
+        }
+    }
+    Operations operations;
+    for (size_t i = 0; i < count; i++) {
+        operations.updates.push_back({random() % side, random() % side, static_cast<int>(random() % 1000)});
+        size_t columns[2] = {random() % side, random() % side};
+        size_t rows[2] = {random() % side, random() % side};
+        std::sort(columns, columns + 2);
+        std::sort(rows, rows + 2);
+        operations.queries.push_back({columns[0], columns[1], rows[0], rows[1]});
+    }
+    std::printf("%zu x %zu grid, %zu updates, %zu queries\n", side, side, count, count);
+    std::printf("%-22s %8s %10s %12s %12s %16s\n", "tree", "build, s", "tree, MiB", "ns/update", "ns/query", "checksum");
+    // the baseline allocates 4 * columns x 4 * rows cells plus a copy of the matrix
+    run<baseline::SegmentTree2D<int>>("baseline", side, 17 * sizeof(int), operations, [&]() {
+        return new baseline::SegmentTree2D<int>(matrix, sum, 0);
+    });
+    run<SegmentTree2D<int>>("flat, function pointer", side, 4 * sizeof(int), operations, [&]() {
+        return new SegmentTree2D<int>(matrix, sum, 0);
+    });
+    run<SegmentTree2D<int, SumMonoid<int>>>("flat, SumMonoid", side, 4 * sizeof(int), operations, [&]() {
+        return new SegmentTree2D<int, SumMonoid<int>>(matrix);
+    });
+    return 0;
+}
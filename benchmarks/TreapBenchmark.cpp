@@ -0,0 +1,68 @@
+#include <vector>
+#include <cstdint>
+#include <algorithm>
+#include "Benchmark.h"
+#include "Treap.h"
+#include "baseline/Treap.h"
+
+// the iterative slab Treap against the baseline recursive unique_ptr Treap:
+// n inserts of distinct random keys, then n erases; the slab is reserved up front.
+// The baseline copies its generator into every node, so all priorities are equal
+// and the tree degenerates into a path: its inserts cost O(n) and recurse n deep,
+// so it only runs on sizes its stack survives
+void reserve(Treap<uint64_t>& set, size_t count) {
+    set.reserve(count);
+}
+
+void reserve(baseline::Treap<uint64_t>&, size_t) { }
+
+template<typename Set>
+void run(const std::vector<uint64_t>& keys, double& insertTime, double& eraseTime) {
+    Set set;
+    reserve(set, keys.size());
+    insertTime = measure([&]() {
+        for (uint64_t key : keys) {
+            set.insert(key);
+        }
+    });
+    if (set.size() != keys.size()) {
+        std::printf("size mismatch\n");
+        std::exit(1);
+    }
+    eraseTime = measure([&]() {
+        for (uint64_t key : keys) {
+            set.erase(key);
+        }
+    });
+}
+
+std::vector<uint64_t> randomKeys(size_t n) {
+    std::mt19937_64 random(1);
+    std::vector<uint64_t> keys(n);
+    for (uint64_t& key : keys) {
+        key = random();
+    }
+    return keys;
+}
+
+int main(int argc, char** argv) {
+    const size_t scale = scaleArgument(argc, argv);
+    std::printf("%10s %10s %12s %12s %10s\n", "elements", "treap", "insert, s", "erase, s", "ns/insert");
+    for (size_t n : {10000, 30000}) {
+        n /= scale;
+        const std::vector<uint64_t> keys = randomKeys(n);
+        double insertTime, eraseTime;
+        run<baseline::Treap<uint64_t>>(keys, insertTime, eraseTime);
+        std::printf("%10zu %10s %12.3f %12.3f %10.0f\n", n, "baseline", insertTime, eraseTime, insertTime * 1e9 / n);
+        run<Treap<uint64_t>>(keys, insertTime, eraseTime);
+        std::printf("%10zu %10s %12.3f %12.3f %10.0f\n", n, "slab", insertTime, eraseTime, insertTime * 1e9 / n);
+    }
+    for (size_t n : {1000000, 10000000, 100000000}) {
+        n /= scale;
+        const std::vector<uint64_t> keys = randomKeys(n);
+        double insertTime, eraseTime;
+        run<Treap<uint64_t>>(keys, insertTime, eraseTime);
+        std::printf("%10zu %10s %12.3f %12.3f %10.0f\n", n, "slab", insertTime, eraseTime, insertTime * 1e9 / n);
+    }
+    return 0;
+}
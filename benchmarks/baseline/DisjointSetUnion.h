@@ -0,0 +1,72 @@
+#pragma once
+#include <unordered_map>
+#include <iostream>
+#include <cstdint>
+#include <algorithm>
+
+// DisjointSetUnion.h as of the baseline commit, kept for benchmark comparisons
+namespace baseline {
+
+template<typename Set>
+class DisjointSetUnion {
+public:
+    DisjointSetUnion() { }
+
+    DisjointSetUnion(const DisjointSetUnion& other) : base(other.base) { }
+    DisjointSetUnion(DisjointSetUnion&& other) : base(std::move(other.base)) { }
+
+    void makeSet(const Set& set) {
+        base[set] = {set, 0};
+    }
+
+    Set findSet(const Set& set) const {
+        Node parentNode = base.at(set);
+        if (set == parentNode.parent) {
+            return set;
+        }
+        parentNode.parent = findSet(parentNode.parent);
+        return parentNode.parent;
+    }
+
+    void unionSets(const Set& first, const Set& second) {
+        Set firstParent = findSet(first);
+        Set secondParent = findSet(second);
+        if (firstParent != secondParent) {
+            if (base[firstParent].rank < base[secondParent].rank) {
+                std::swap(firstParent, secondParent);
+            }
+            base[secondParent].parent = firstParent;
+            if (base[firstParent].rank == base[secondParent].rank) {
+                ++base[firstParent].rank;
+            }
+        }
+    }
+
+    size_t size() const {
+        return base.size();
+    }
+
+    void clear() {
+        base.clear();
+    }
+
+    DisjointSetUnion& operator=(const DisjointSetUnion& other) {
+        base = other.base;
+        return *this;
+    }
+
+    DisjointSetUnion& operator=(DisjointSetUnion&& other) {
+        base = std::move(other.base);
+        return *this;
+    }
+
+private:
+    struct Node{
+        Set parent;
+        uint64_t rank;
+    };
+
+    std::unordered_map<Set, Node> base;
+};
+
+}  // namespace baseline
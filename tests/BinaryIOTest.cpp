@@ -0,0 +1,148 @@
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <random>
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <stdexcept>
+#include "Test.h"
+#include "BinaryIO.h"
+
+// Matrix2D and SegmentTree2D written by BinaryIO and read back, then the
+// same files with a flipped payload byte, a foreign byte order marker, a
+// wrong element type and a cut-off payload, each rejected with its own error
+const char* const MATRIX_PATH = "BinaryIOTest.matrix.bin";
+const char* const TREE_PATH = "BinaryIOTest.tree.bin";
+
+std::vector<unsigned char> readFile(const char* path) {
+    std::vector<unsigned char> bytes;
+    std::FILE* file = std::fopen(path, "rb");
+    if (file == nullptr) {
+        return bytes;
+    }
+    int byte;
+    while ((byte = std::fgetc(file)) != EOF) {
+        bytes.push_back(static_cast<unsigned char>(byte));
+    }
+    std::fclose(file);
+    return bytes;
+}
+
+void writeFile(const char* path, const std::vector<unsigned char>& bytes) {
+    std::FILE* file = std::fopen(path, "wb");
+    std::fwrite(bytes.data(), 1, bytes.size(), file);
+    std::fclose(file);
+}
+
+// the message of the runtime_error 'function' throws, empty if none
+template<typename Function>
+std::string errorOf(Function function) {
+    try {
+        function();
+    } catch (const std::runtime_error& error) {
+        return error.what();
+    }
+    return "";
+}
+
+template<typename T>
+bool sameMatrix(const Matrix2D<T>& first, const Matrix2D<T>& second) {
+    const auto size = first.size();
+    return size == second.size() &&
+           std::equal(first.data(), first.data() + size.first * size.second, second.data());
+}
+
+void testMatrix() {
+    std::mt19937 random(1);
+    Matrix2D<int64_t> matrix(37, 5);
+    for (size_t i = 0; i < 37; i++) {
+        for (size_t j = 0; j < 5; j++) {
+            matrix(i, j) = static_cast<int64_t>(random()) - (1ll << 31);
+        }
+    }
+    BinaryIO::save(matrix, MATRIX_PATH);
+    CHECK(sameMatrix(BinaryIO::loadMatrix2D<int64_t>(MATRIX_PATH), matrix));
+    CHECK(errorOf([]() { BinaryIO::loadMatrix2D<int32_t>(MATRIX_PATH); }) == "file holds another type");
+
+    const std::vector<unsigned char> original = readFile(MATRIX_PATH);
+    std::vector<unsigned char> bytes = original;
+    bytes[BinaryFile::PAYLOAD_OFFSET + 17] ^= 0x40;
+    writeFile(MATRIX_PATH, bytes);
+    CHECK(errorOf([]() { BinaryIO::loadMatrix2D<int64_t>(MATRIX_PATH); }) == "checksum mismatch");
+
+    // the marker as a machine of the other byte order writes it
+    bytes = original;
+    const uint32_t marker = BinaryFile::ENDIANNESS_MARKER;
+    const uint32_t swapped = (marker >> 24) | ((marker >> 8) & 0xff00u) |
+                             ((marker << 8) & 0xff0000u) | (marker << 24);
+    std::memcpy(&bytes[offsetof(BinaryFile::Header, byteOrder)], &swapped, sizeof(swapped));
+    writeFile(MATRIX_PATH, bytes);
+    CHECK(errorOf([]() { BinaryIO::loadMatrix2D<int64_t>(MATRIX_PATH); }) == "unsupported byte order");
+
+    bytes = original;
+    bytes.resize(bytes.size() - 1);
+    writeFile(MATRIX_PATH, bytes);
+    CHECK(errorOf([]() { BinaryIO::loadMatrix2D<int64_t>(MATRIX_PATH); }) == "file is too short");
+
+    bytes = original;
+    bytes[0] = 'X';
+    writeFile(MATRIX_PATH, bytes);
+    CHECK(errorOf([]() { BinaryIO::loadMatrix2D<int64_t>(MATRIX_PATH); }) == "unknown file format");
+    std::remove(MATRIX_PATH);
+    CHECK(errorOf([]() { BinaryIO::loadMatrix2D<int64_t>(MATRIX_PATH); }) ==
+          std::string("cannot open ") + MATRIX_PATH);
+
+    const Matrix2D<double> empty;
+    BinaryIO::save(empty, MATRIX_PATH);
+    CHECK(sameMatrix(BinaryIO::loadMatrix2D<double>(MATRIX_PATH), empty));
+    std::remove(MATRIX_PATH);
+}
+
+void testSegmentTree() {
+    std::mt19937 random(2);
+    std::vector<std::vector<int>> grid(23, std::vector<int>(41));
+    for (auto& line : grid) {
+        for (int& value : line) {
+            value = static_cast<int>(random() % 1000);
+        }
+    }
+    SegmentTree2D<int, SumMonoid<int>> tree(grid);
+    tree.update(3, 7, -5);
+    BinaryIO::save(tree, TREE_PATH);
+    {
+        const MappedSegmentTree2D<int, SumMonoid<int>> mapped(TREE_PATH);
+        CHECK(mapped.columnsSize() == 23 && mapped.rowsSize() == 41);
+        bool same = true;
+        for (size_t i = 0; i < 500; i++) {
+            const size_t fromColumn = random() % 23;
+            const size_t toColumn = fromColumn + random() % (23 - fromColumn);
+            const size_t fromRow = random() % 41;
+            const size_t toRow = fromRow + random() % (41 - fromRow);
+            same &= mapped.query(fromColumn, toColumn, fromRow, toRow) ==
+                    tree.query(fromColumn, toColumn, fromRow, toRow);
+        }
+        CHECK(same);
+    }
+    // a matrix file is not a tree file, even with the same element type
+    Matrix2D<int> matrix(2, 2);
+    BinaryIO::save(matrix, MATRIX_PATH);
+    CHECK(errorOf([]() { MappedSegmentTree2D<int, SumMonoid<int>> mapped(MATRIX_PATH); }) ==
+          "file holds another type");
+    std::remove(MATRIX_PATH);
+
+    std::vector<unsigned char> bytes = readFile(TREE_PATH);
+    bytes.back() ^= 1;
+    writeFile(TREE_PATH, bytes);
+    CHECK(errorOf([]() { MappedSegmentTree2D<int, SumMonoid<int>> mapped(TREE_PATH); }) == "checksum mismatch");
+    // without the check the file opens, only the last cell differs
+    const MappedSegmentTree2D<int, SumMonoid<int>> unchecked(TREE_PATH, SumMonoid<int>(), false);
+    CHECK(unchecked.query(0, 21, 0, 40) == tree.query(0, 21, 0, 40));
+    std::remove(TREE_PATH);
+}
+
+int main() {
+    testMatrix();
+    testSegmentTree();
+    return testResult("BinaryIOTest");
+}
@@ -0,0 +1,149 @@
+#include <atomic>
+#include <random>
+#include <thread>
+#include <vector>
+#include <cstdint>
+#include <stdexcept>
+#include "Test.h"
+#include "ThreadPool.h"
+#include "DisjointSetUnion.h"
+#include "ConcurrentDisjointSetUnion.h"
+
+// ConcurrentDisjointSetUnion against the sequential DisjointSetUnion:
+// unionBatch on the pool, and unions racing with sameSet on raw threads
+using Pairs = std::vector<std::pair<uint32_t, uint32_t>>;
+
+Pairs randomPairs(size_t sets, size_t count, uint32_t seed) {
+    std::mt19937 random(seed);
+    Pairs pairs(count);
+    for (auto& pair : pairs) {
+        pair = {static_cast<uint32_t>(random() % sets), static_cast<uint32_t>(random() % sets)};
+    }
+    return pairs;
+}
+
+// the partition of 'concurrent' equals the one of 'sequential' when their
+// roots map one to one
+bool samePartition(ConcurrentDisjointSetUnion& concurrent, DisjointSetUnion<uint32_t>& sequential) {
+    const uint32_t sets = static_cast<uint32_t>(concurrent.size());
+    std::vector<uint32_t> concurrentRootOf(sets, UINT32_MAX);
+    std::vector<uint32_t> sequentialRootOf(sets, UINT32_MAX);
+    for (uint32_t set = 0; set < sets; set++) {
+        const uint32_t concurrentRoot = concurrent.findSet(set);
+        const uint32_t sequentialRoot = sequential.findSet(set);
+        if (concurrentRootOf[concurrentRoot] == UINT32_MAX) {
+            concurrentRootOf[concurrentRoot] = sequentialRoot;
+        }
+        if (sequentialRootOf[sequentialRoot] == UINT32_MAX) {
+            sequentialRootOf[sequentialRoot] = concurrentRoot;
+        }
+        if (concurrentRootOf[concurrentRoot] != sequentialRoot || sequentialRootOf[sequentialRoot] != concurrentRoot) {
+            return false;
+        }
+    }
+    return true;
+}
+
+DisjointSetUnion<uint32_t> sequentialUnion(size_t sets, const Pairs& pairs, size_t& merged) {
+    DisjointSetUnion<uint32_t> sequential;
+    for (uint32_t set = 0; set < sets; set++) {
+        sequential.makeSet(set);
+    }
+    merged = sequential.unionBatch(pairs);
+    return sequential;
+}
+
+void testUnionBatch(size_t sets, size_t count, size_t threads) {
+    ThreadPool::shared().resize(threads);
+    const Pairs pairs = randomPairs(sets, count, static_cast<uint32_t>(sets + threads));
+    size_t expectedMerged = 0;
+    DisjointSetUnion<uint32_t> sequential = sequentialUnion(sets, pairs, expectedMerged);
+    ConcurrentDisjointSetUnion concurrent(sets);
+    CHECK(concurrent.unionBatch(pairs) == expectedMerged);
+    CHECK(samePartition(concurrent, sequential));
+    const ConcurrentDisjointSetUnion::Components components = concurrent.components();
+    CHECK(components.sizes.size() == sets - expectedMerged);
+    bool consistent = true;
+    for (const auto& pair : pairs) {
+        consistent &= concurrent.sameSet(pair.first, pair.second);
+        consistent &= components.labels[pair.first] == components.labels[pair.second];
+    }
+    CHECK(consistent);
+}
+
+// writers union their share of the pairs and publish how far they got;
+// readers check that sameSet is true for every published pair and that a
+// 'true' never contradicts the final partition
+void testRacingSameSet(size_t sets, size_t count, size_t writers, size_t readers) {
+    const Pairs pairs = randomPairs(sets, count, static_cast<uint32_t>(count));
+    size_t expectedMerged = 0;
+    DisjointSetUnion<uint32_t> sequential = sequentialUnion(sets, pairs, expectedMerged);
+    std::vector<uint32_t> roots(sets);
+    for (uint32_t set = 0; set < sets; set++) {
+        roots[set] = sequential.findSet(set);
+    }
+    ConcurrentDisjointSetUnion concurrent(sets);
+    std::vector<std::atomic<size_t>> done(writers);
+    std::atomic<size_t> merged(0);
+    std::atomic<size_t> missed(0);
+    std::atomic<size_t> wrong(0);
+    std::atomic<size_t> finished(0);
+    std::vector<std::thread> threads;
+    for (size_t writer = 0; writer < writers; writer++) {
+        done[writer].store(0);
+        threads.emplace_back([&, writer]() {
+            size_t local = 0;
+            for (size_t i = writer; i < pairs.size(); i += writers) {
+                local += concurrent.unionSets(pairs[i].first, pairs[i].second);
+                done[writer].store(i + 1, std::memory_order_release);
+            }
+            merged += local;
+            ++finished;
+        });
+    }
+    for (size_t reader = 0; reader < readers; reader++) {
+        threads.emplace_back([&, reader]() {
+            std::mt19937 random(static_cast<uint32_t>(reader));
+            while (finished.load() < writers) {
+                const size_t writer = random() % writers;
+                const size_t published = done[writer].load(std::memory_order_acquire);
+                if (published > writer) {
+                    // the last pair this writer published
+                    const auto& pair = pairs[(published - 1 - writer) / writers * writers + writer];
+                    missed += !concurrent.sameSet(pair.first, pair.second);
+                }
+                const uint32_t first = static_cast<uint32_t>(random() % sets);
+                const uint32_t second = static_cast<uint32_t>(random() % sets);
+                wrong += concurrent.sameSet(first, second) && roots[first] != roots[second];
+            }
+        });
+    }
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+    CHECK(merged.load() == expectedMerged);
+    CHECK(missed.load() == 0);
+    CHECK(wrong.load() == 0);
+    CHECK(samePartition(concurrent, sequential));
+}
+
+void testErrors() {
+    ConcurrentDisjointSetUnion concurrent(4);
+    CHECK(throws<std::out_of_range>([&]() { concurrent.findSet(4); }));
+    CHECK(throws<std::out_of_range>([&]() { concurrent.unionBatch({{0, 1}, {2, 7}}); }));
+    CHECK(concurrent.findSet(1) == 1);
+    CHECK(concurrent.unionSets(0, 1));
+    CHECK(!concurrent.unionSets(1, 0));
+    CHECK(concurrent.sameSet(0, 1) && !concurrent.sameSet(0, 2));
+}
+
+int main() {
+    for (size_t threads : {1, 2, 4, 8}) {
+        testUnionBatch(1000, 600, threads);
+        testUnionBatch(1 << 16, 1 << 17, threads);
+    }
+    testRacingSameSet(1 << 12, 1 << 13, 4, 4);
+    testRacingSameSet(1 << 16, 1 << 17, 2, 6);
+    testErrors();
+    return testResult("ConcurrentDisjointSetUnionTest");
+}
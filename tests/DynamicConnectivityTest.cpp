@@ -0,0 +1,110 @@
+#include <map>
+#include <queue>
+#include <random>
+#include <vector>
+#include <cstdint>
+#include <stdexcept>
+#include "Test.h"
+#include "DynamicConnectivity.h"
+
+// offline DynamicConnectivity against a breadth-first search over the live
+// multigraph at every query: random insertions, removals of present edges
+// (duplicates included) and queries
+using Edge = std::pair<uint32_t, uint32_t>;
+
+bool connected(size_t vertices, const std::multimap<uint32_t, uint32_t>& adjacent,
+               uint32_t first, uint32_t second) {
+    std::vector<bool> seen(vertices);
+    std::queue<uint32_t> pending;
+    pending.push(first);
+    seen[first] = true;
+    while (!pending.empty()) {
+        const uint32_t vertex = pending.front();
+        pending.pop();
+        if (vertex == second) {
+            return true;
+        }
+        const auto range = adjacent.equal_range(vertex);
+        for (auto it = range.first; it != range.second; ++it) {
+            if (!seen[it->second]) {
+                seen[it->second] = true;
+                pending.push(it->second);
+            }
+        }
+    }
+    return false;
+}
+
+void eraseOne(std::multimap<uint32_t, uint32_t>& adjacent, uint32_t from, uint32_t to) {
+    const auto range = adjacent.equal_range(from);
+    for (auto it = range.first; it != range.second; ++it) {
+        if (it->second == to) {
+            adjacent.erase(it);
+            return;
+        }
+    }
+}
+
+void testRandom(size_t vertices, size_t steps, uint32_t seed) {
+    std::mt19937 random(seed);
+    DynamicConnectivity graph(vertices);
+    std::multimap<uint32_t, uint32_t> adjacent;
+    std::vector<Edge> live;
+    std::vector<bool> expected;
+    for (size_t step = 0; step < steps; step++) {
+        const uint32_t kind = random() % 3;
+        if (kind == 0 || live.empty()) {
+            const uint32_t first = random() % vertices;
+            const uint32_t second = random() % vertices;
+            graph.addEdge(first, second);
+            live.push_back({first, second});
+            adjacent.insert({first, second});
+            adjacent.insert({second, first});
+        } else if (kind == 1) {
+            // removed by the reversed endpoints half of the time
+            const size_t index = random() % live.size();
+            const Edge edge = live[index];
+            live[index] = live.back();
+            live.pop_back();
+            if (random() % 2) {
+                graph.removeEdge(edge.second, edge.first);
+            } else {
+                graph.removeEdge(edge.first, edge.second);
+            }
+            eraseOne(adjacent, edge.first, edge.second);
+            eraseOne(adjacent, edge.second, edge.first);
+        } else {
+            const uint32_t first = random() % vertices;
+            const uint32_t second = random() % vertices;
+            graph.query(first, second);
+            expected.push_back(connected(vertices, adjacent, first, second));
+        }
+    }
+    CHECK(graph.solve() == expected);
+}
+
+void testExample() {
+    DynamicConnectivity graph(4);
+    graph.addEdge(0, 1);
+    graph.addEdge(1, 2);
+    graph.query(0, 2);
+    graph.addEdge(0, 1);
+    graph.removeEdge(1, 0);
+    graph.query(0, 2);
+    graph.removeEdge(0, 1);
+    graph.query(0, 2);
+    graph.query(3, 3);
+    CHECK(graph.solve() == std::vector<bool>({true, true, false, true}));
+    CHECK(throws<std::invalid_argument>([&]() { graph.removeEdge(0, 1); }));
+    CHECK(throws<std::out_of_range>([&]() { graph.query(0, 4); }));
+    graph.clear();
+    CHECK(graph.solve().empty());
+}
+
+int main() {
+    testRandom(6, 300, 1);
+    testRandom(30, 3000, 2);
+    testRandom(200, 6000, 3);
+    testExample();
+    return testResult("DynamicConnectivityTest");
+}
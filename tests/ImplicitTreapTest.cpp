@@ -0,0 +1,111 @@
+#include <random>
+#include <vector>
+#include <cstdint>
+#include <numeric>
+#include <algorithm>
+#include <stdexcept>
+#include "Test.h"
+#include "ImplicitTreap.h"
+
+// ImplicitTreap against a std::vector edited the same way: inserts and
+// erases at any position, reversed and shifted ranges whose lazy tags pile
+// up on each other, and range queries that cut the range out and paste it back
+using Sequence = std::vector<int64_t>;
+
+struct Span {
+    size_t from;
+    size_t to;
+};
+
+Span randomSpan(size_t size, std::mt19937& random) {
+    size_t from = random() % size;
+    size_t to = random() % size;
+    if (from > to) {
+        std::swap(from, to);
+    }
+    return {from, to};
+}
+
+void testRandom(size_t steps, uint32_t seed) {
+    std::mt19937 random(seed);
+    ImplicitTreap<int64_t> rope;
+    Sequence sequence;
+    bool same = true;
+    for (size_t step = 0; step < steps; step++) {
+        const uint32_t kind = sequence.size() < 2 ? 0 : random() % 9;
+        const int64_t value = static_cast<int64_t>(random() % 2001) - 1000;
+        if (kind == 0) {
+            const size_t position = random() % (sequence.size() + 1);
+            rope.insertAt(position, value);
+            sequence.insert(sequence.begin() + position, value);
+        } else if (kind == 1) {
+            rope.pushBack(value);
+            sequence.push_back(value);
+        } else if (kind == 2) {
+            const size_t position = random() % sequence.size();
+            rope.eraseAt(position);
+            sequence.erase(sequence.begin() + position);
+        } else if (kind == 3 && sequence.size() > 20) {
+            const Span span = randomSpan(sequence.size(), random);
+            rope.eraseRange(span.from, span.to);
+            sequence.erase(sequence.begin() + span.from, sequence.begin() + span.to + 1);
+        } else if (kind <= 5) {
+            const Span span = randomSpan(sequence.size(), random);
+            rope.reverseRange(span.from, span.to);
+            std::reverse(sequence.begin() + span.from, sequence.begin() + span.to + 1);
+        } else if (kind == 6) {
+            const Span span = randomSpan(sequence.size(), random);
+            rope.addRange(span.from, span.to, value);
+            for (size_t i = span.from; i <= span.to; i++) {
+                sequence[i] += value;
+            }
+        } else {
+            const Span span = randomSpan(sequence.size(), random);
+            const auto first = sequence.begin() + span.from;
+            const auto last = sequence.begin() + span.to + 1;
+            same &= rope.sumRange(span.from, span.to) == std::accumulate(first, last, int64_t(0));
+            same &= rope.minRange(span.from, span.to) == *std::min_element(first, last);
+            same &= rope.maxRange(span.from, span.to) == *std::max_element(first, last);
+        }
+        same &= rope.size() == sequence.size();
+        if (!sequence.empty()) {
+            const size_t position = random() % sequence.size();
+            same &= rope.at(position) == sequence[position];
+        }
+    }
+    CHECK(same);
+    CHECK(rope.toVector() == sequence);
+}
+
+void testExample() {
+    ImplicitTreap<int64_t> rope;
+    rope.pushBack(1);
+    rope.pushBack(2);
+    rope.pushBack(3);
+    rope.insertAt(1, 5);
+    rope.reverseRange(0, 2);
+    rope.addRange(1, 3, 10);
+    CHECK(rope.toVector() == Sequence({2, 15, 11, 13}));
+    CHECK(rope.sumRange(0, 1) == 17);
+    // a reversal over a pending add, and an add over a pending reversal
+    rope.reverseRange(1, 3);
+    rope.addRange(0, 1, -2);
+    rope.reverseRange(0, 3);
+    CHECK(rope.toVector() == Sequence({15, 11, 11, 0}));
+    CHECK(rope.minRange(0, 3) == 0 && rope.maxRange(0, 2) == 15);
+    CHECK(throws<std::out_of_range>([&]() { rope.insertAt(5, 0); }));
+    CHECK(throws<std::out_of_range>([&]() { rope.at(4); }));
+    CHECK(throws<std::out_of_range>([&]() { rope.sumRange(2, 1); }));
+    CHECK(throws<std::out_of_range>([&]() { rope.reverseRange(0, 4); }));
+    rope.eraseRange(0, 3);
+    CHECK(rope.size() == 0);
+    rope.pushBack(7);
+    CHECK(rope.toVector() == Sequence({7}));
+}
+
+int main() {
+    testRandom(3000, 1);
+    testRandom(30000, 2);
+    testExample();
+    return testResult("ImplicitTreapTest");
+}
@@ -0,0 +1,84 @@
+#include <sstream>
+#include <cstdint>
+#include <stdexcept>
+#include "Test.h"
+#include "Matrix2D.h"
+
+// element-wise expressions keep reading and writing like the matrices they
+// stand for: printing, 'auto' results, writes through at() and pow()
+template<typename Matrix>
+std::string print(const Matrix& matrix) {
+    std::ostringstream out;
+    out << matrix;
+    return out.str();
+}
+
+void testPrint(const Matrix2D<int>& a, const Matrix2D<int>& b) {
+    const Matrix2D<int> sum = a + b;
+    CHECK(print(a + b) == print(sum));
+    CHECK(print(a - b * 2) == print(Matrix2D<int>(a - b * 2)));
+    CHECK(print(a + b) == "[[6, 8]\n[10, 12]]\n");
+}
+
+void testAutoWrite(const Matrix2D<int>& a, const Matrix2D<int>& b) {
+    auto c = a + b;
+    CHECK(c.at(1, 1) == 12);
+    c.at(0, 0) = 1;
+    CHECK(c.at(0, 0) == 1);
+    CHECK(c(0, 1) == 8);
+    // reads and evaluations after the write see it
+    const Matrix2D<int> copy = c;
+    CHECK(copy(0, 0) == 1 && copy(1, 1) == 12);
+    const Matrix2D<int> chained = c + a;
+    CHECK(chained(0, 0) == 2 && chained(1, 0) == 13);
+    Matrix2D<int> accumulated = a;
+    accumulated += c * 2;
+    CHECK(accumulated(0, 0) == 3 && accumulated(0, 1) == 18);
+    CHECK(c.eval()(0, 0) == 1);
+    // a copied node owns its own matrix
+    auto other = c;
+    other(1, 1) = 0;
+    CHECK(c(1, 1) == 12 && other(1, 1) == 0);
+    CHECK(throws<std::out_of_range>([&]() { c.at(2, 0) = 1; }));
+    // the operands are untouched
+    CHECK(a(0, 0) == 1 && b(0, 0) == 5);
+}
+
+void testMovedOperand(const Matrix2D<int>& a, const Matrix2D<int>& b) {
+    auto c = Matrix2D<int>(a) + b;
+    c(0, 0) = 100;
+    const Matrix2D<int> result = std::move(c);
+    CHECK(result(0, 0) == 100 && result(1, 1) == 12);
+}
+
+void testPow(const Matrix2D<int>& a, const Matrix2D<int>& b) {
+    const Matrix2D<int> sum = a + b;
+    const Matrix2D<int> square = (a + b).pow(2);
+    const Matrix2D<int> product = sum * sum;
+    CHECK(print(square) == print(product));
+    CHECK(print((a - b).pow(0)) == print(Matrix2D<int>(2)));
+    const Matrix2D<uint32_t> steps({{1, 1}, {1, 0}});
+    const Matrix2D<uint32_t> fibonacci = (steps * 1u).pow(10, ModularSemiring(7));
+    CHECK(fibonacci(0, 1) == 55 % 7);
+    CHECK(throws<std::logic_error>([]() { (Matrix2D<int>(2, 3) + Matrix2D<int>(2, 3)).pow(2); }));
+}
+
+void testEval(const Matrix2D<int>& a, const Matrix2D<int>& b) {
+    const auto doubled = a * 2;
+    const Matrix2D<int> evaluated = doubled.eval();
+    CHECK(evaluated(1, 0) == 6);
+    CHECK(doubled.at(1, 1) == 8);
+    CHECK(throws<std::out_of_range>([&]() { doubled.at(0, 2); }));
+    CHECK((a + b).eval().size() == a.size());
+}
+
+int main() {
+    const Matrix2D<int> a({{1, 2}, {3, 4}});
+    const Matrix2D<int> b({{5, 6}, {7, 8}});
+    testPrint(a, b);
+    testAutoWrite(a, b);
+    testMovedOperand(a, b);
+    testPow(a, b);
+    testEval(a, b);
+    return testResult("MatrixExpressionTest");
+}
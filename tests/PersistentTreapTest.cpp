@@ -0,0 +1,182 @@
+#include <set>
+#include <cmath>
+#include <mutex>
+#include <atomic>
+#include <memory>
+#include <random>
+#include <thread>
+#include <vector>
+#include <cstdint>
+#include <algorithm>
+#include "Test.h"
+#include "PersistentTreap.h"
+
+// PersistentTreap with readers holding snapshots while a writer inserts and
+// erases: every snapshot keeps reading the state it was taken at. Then
+// memoryOverhead against the number of nodes actually freed with the snapshot,
+// counted through the live instances of the element type, and the number of
+// nodes an update copies
+
+// int that counts its live and its copied instances; every node holds
+// exactly one, copied from its element or from the node it replaces
+struct Counted {
+    int value;
+
+    static std::atomic<long>& live() {
+        static std::atomic<long> count(0);
+        return count;
+    }
+
+    static std::atomic<long>& copies() {
+        static std::atomic<long> count(0);
+        return count;
+    }
+
+    Counted(int value) : value(value) {
+        ++live();
+    }
+
+    Counted(const Counted& other) : value(other.value) {
+        ++live();
+        ++copies();
+    }
+
+    ~Counted() {
+        --live();
+    }
+
+    Counted& operator=(const Counted& other) = default;
+
+    bool operator<(const Counted& other) const {
+        return value < other.value;
+    }
+};
+
+using IntTreap = PersistentTreap<int, std::less<int>>;
+using CountedTreap = PersistentTreap<Counted, std::less<Counted>>;
+
+std::vector<int> values(const std::multiset<int>& set) {
+    return std::vector<int>(set.begin(), set.end());
+}
+
+// the writer publishes every snapshot with the contents it must keep showing;
+// readers check random published ones and fresh ones taken from the treap
+void testReaders(size_t steps, size_t readers) {
+    IntTreap treap;
+    std::mutex mutex;
+    std::vector<std::pair<IntTreap::Snapshot, std::vector<int>>> published;
+    std::atomic<bool> done(false);
+    std::atomic<size_t> wrong(0);
+    std::vector<std::thread> threads;
+    for (size_t reader = 0; reader < readers; reader++) {
+        threads.emplace_back([&, reader]() {
+            std::mt19937 random(static_cast<uint32_t>(reader));
+            while (!done.load()) {
+                std::unique_ptr<std::pair<IntTreap::Snapshot, std::vector<int>>> held;
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    if (!published.empty()) {
+                        held.reset(new std::pair<IntTreap::Snapshot, std::vector<int>>(
+                                published[random() % published.size()]));
+                    }
+                }
+                if (held) {
+                    wrong += held->first.toVector() != held->second;
+                    wrong += held->first.size() != held->second.size();
+                    const int probe = static_cast<int>(random() % 200);
+                    wrong += held->first.contains(probe) !=
+                            std::binary_search(held->second.begin(), held->second.end(), probe);
+                }
+                const std::vector<int> current = treap.snapshot().toVector();
+                wrong += !std::is_sorted(current.begin(), current.end());
+            }
+        });
+    }
+    std::mt19937 random(1);
+    std::multiset<int> reference;
+    for (size_t step = 0; step < steps; step++) {
+        const int value = static_cast<int>(random() % 200);
+        if (random() % 3 != 0) {
+            treap.insert(value);
+            reference.insert(value);
+        } else {
+            treap.erase(value);
+            reference.erase(value);
+        }
+        if (step % 4 == 0) {
+            std::lock_guard<std::mutex> lock(mutex);
+            published.push_back({treap.snapshot(), values(reference)});
+        }
+    }
+    done.store(true);
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+    CHECK(wrong.load() == 0);
+    CHECK(treap.toVector() == values(reference));
+    bool unchanged = true;
+    for (const auto& entry : published) {
+        unchanged &= entry.first.toVector() == entry.second;
+    }
+    CHECK(unchanged);
+}
+
+// the overhead of one snapshot is exactly what destroying it frees
+void testMemoryOverhead(size_t count, size_t changes, uint32_t seed) {
+    std::mt19937 random(seed);
+    CountedTreap treap;
+    for (size_t i = 0; i < count; i++) {
+        treap.insert(static_cast<int>(random() % (count * 2)));
+    }
+    auto snapshot = std::make_unique<CountedTreap::Snapshot>(treap.snapshot());
+    CHECK(treap.memoryOverhead(*snapshot).nodes == 0);
+    for (size_t i = 0; i < changes; i++) {
+        const int value = static_cast<int>(random() % (count * 2));
+        if (random() % 2) {
+            treap.insert(value);
+        } else {
+            treap.erase(value);
+        }
+    }
+    const CountedTreap::Memory overhead = treap.memoryOverhead(*snapshot);
+    const long before = Counted::live().load();
+    snapshot.reset();
+    CHECK(before - Counted::live().load() == static_cast<long>(overhead.nodes));
+    CHECK(overhead.bytes >= overhead.nodes * sizeof(Counted));
+    // with nothing kept, the whole old tree is the overhead
+    snapshot = std::make_unique<CountedTreap::Snapshot>(treap.snapshot());
+    const size_t size = treap.size();
+    treap.clear();
+    CHECK(treap.memoryOverhead(*snapshot).nodes == size);
+    snapshot.reset();
+    CHECK(Counted::live().load() == 0);
+}
+
+// an update copies each node on its path once, so about the 2 ln n of a
+// search; copying in both split and merge made more than twice that
+void testCopiesPerUpdate(size_t count) {
+    CountedTreap treap;
+    std::mt19937 random(static_cast<uint32_t>(count));
+    for (size_t i = 0; i < count; i++) {
+        treap.insert(static_cast<int>(random()));
+    }
+    const size_t updates = 10000;
+    const long before = Counted::copies().load();
+    for (size_t i = 0; i < updates; i++) {
+        treap.insert(static_cast<int>(random()));
+        treap.erase(static_cast<int>(random()));
+    }
+    const double perUpdate = static_cast<double>(Counted::copies().load() - before) / (2 * updates);
+    CHECK(perUpdate < 1.5 * 2 * std::log(static_cast<double>(count)));
+}
+
+int main() {
+    testReaders(20000, 4);
+    testMemoryOverhead(1000, 1, 1);
+    testMemoryOverhead(1000, 50, 2);
+    testMemoryOverhead(20000, 2000, 3);
+    testMemoryOverhead(20000, 0, 4);
+    testCopiesPerUpdate(1000);
+    testCopiesPerUpdate(100000);
+    return testResult("PersistentTreapTest");
+}
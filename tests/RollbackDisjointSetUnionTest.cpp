@@ -0,0 +1,105 @@
+#include <random>
+#include <vector>
+#include <cstdint>
+#include <stdexcept>
+#include "Test.h"
+#include "RollbackDisjointSetUnion.h"
+
+// RollbackDisjointSetUnion against a naive relabelling union-find whose
+// states are copied at every checkpoint: random unions, nested checkpoints
+// and rollbacks to any of them
+struct NaiveSets {
+    std::vector<uint32_t> label;
+
+    explicit NaiveSets(size_t count) : label(count) {
+        for (size_t i = 0; i < count; i++) {
+            label[i] = static_cast<uint32_t>(i);
+        }
+    }
+
+    bool unite(uint32_t first, uint32_t second) {
+        const uint32_t from = label[first];
+        const uint32_t to = label[second];
+        if (from == to) {
+            return false;
+        }
+        for (uint32_t& value : label) {
+            value = value == from ? to : value;
+        }
+        return true;
+    }
+
+    size_t components() const {
+        size_t count = 0;
+        for (size_t i = 0; i < label.size(); i++) {
+            count += label[i] == label[label[i]] && label[i] == i;
+        }
+        return count;
+    }
+};
+
+bool sameSets(const RollbackDisjointSetUnion& dsu, const NaiveSets& naive) {
+    const size_t count = naive.label.size();
+    for (uint32_t first = 0; first < count; first++) {
+        for (uint32_t second = first; second < count; second += 7) {
+            if (dsu.sameSet(first, second) != (naive.label[first] == naive.label[second])) {
+                return false;
+            }
+        }
+    }
+    return dsu.componentsCount() == naive.components();
+}
+
+void testRandomRollbacks(size_t count, size_t steps, uint32_t seed) {
+    std::mt19937 random(seed);
+    RollbackDisjointSetUnion dsu(count);
+    NaiveSets naive(count);
+    // checkpoint marks with the naive state they stand for
+    std::vector<std::pair<size_t, NaiveSets>> checkpoints;
+    bool unionsAgree = true;
+    bool statesAgree = true;
+    for (size_t step = 0; step < steps; step++) {
+        const uint32_t kind = random() % 10;
+        if (kind < 6) {
+            const uint32_t first = random() % count;
+            const uint32_t second = random() % count;
+            unionsAgree &= dsu.unionSets(first, second) == naive.unite(first, second);
+        } else if (kind < 8) {
+            checkpoints.push_back({dsu.checkpoint(), naive});
+        } else if (!checkpoints.empty()) {
+            // back to a random earlier checkpoint, dropping the later ones
+            checkpoints.erase(checkpoints.begin() + random() % checkpoints.size() + 1, checkpoints.end());
+            dsu.rollbackTo(checkpoints.back().first);
+            naive = checkpoints.back().second;
+            statesAgree &= sameSets(dsu, naive);
+        }
+    }
+    statesAgree &= sameSets(dsu, naive);
+    dsu.rollbackTo(0);
+    statesAgree &= dsu.componentsCount() == count && !dsu.sameSet(0, 1);
+    CHECK(unionsAgree);
+    CHECK(statesAgree);
+}
+
+void testSingleRollback() {
+    RollbackDisjointSetUnion dsu(4);
+    CHECK(dsu.unionSets(0, 1));
+    CHECK(!dsu.unionSets(1, 0));
+    CHECK(dsu.unionSets(2, 3));
+    CHECK(dsu.componentsCount() == 2);
+    dsu.rollback();
+    CHECK(dsu.sameSet(0, 1) && !dsu.sameSet(2, 3) && dsu.componentsCount() == 3);
+    CHECK(dsu.makeSets(2) == 4 && dsu.size() == 6 && dsu.componentsCount() == 5);
+    dsu.rollback();
+    CHECK(throws<std::invalid_argument>([&]() { dsu.rollback(); }));
+    CHECK(throws<std::invalid_argument>([&]() { dsu.rollbackTo(1); }));
+    CHECK(throws<std::out_of_range>([&]() { dsu.findSet(6); }));
+}
+
+int main() {
+    testRandomRollbacks(8, 2000, 1);
+    testRandomRollbacks(64, 5000, 2);
+    testRandomRollbacks(500, 5000, 3);
+    testSingleRollback();
+    return testResult("RollbackDisjointSetUnionTest");
+}
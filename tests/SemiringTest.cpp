@@ -0,0 +1,138 @@
+#include <random>
+#include <limits>
+#include <cstdint>
+#include <algorithm>
+#include "Test.h"
+#include "Matrix2D.h"
+
+// products over the tropical semirings with weights near the limits of
+// the type, and modular products of operands that are not reduced
+template<typename T>
+T clampedSum(const T a, const T b, const T infinity) {
+    if (a == infinity || b == infinity) {
+        return infinity;
+    }
+    const long double sum = static_cast<long double>(a) + b;
+    if (sum >= static_cast<long double>(std::numeric_limits<T>::max())) {
+        return std::numeric_limits<T>::max();
+    }
+    if (sum <= static_cast<long double>(std::numeric_limits<T>::lowest())) {
+        return std::numeric_limits<T>::lowest();
+    }
+    return a + b;
+}
+
+// weights around half the range towards the infinity, so many sums overflow,
+// against a naive product; n covers whole vectors and the scalar tail
+template<typename T, typename Semiring, bool Minimum>
+void testTropical(const size_t n) {
+    const Semiring semiring;
+    const T infinity = semiring.zero();
+    const T half = Minimum ? std::numeric_limits<T>::max() / 2 : std::numeric_limits<T>::lowest() / 2;
+    std::mt19937 random(static_cast<uint32_t>(n));
+    Matrix2D<T> weights(n, n);
+    for (size_t i = 0; i < n; i++) {
+        for (size_t j = 0; j < n; j++) {
+            const T small = static_cast<T>(random() % 100);
+            if (random() % 5 == 0) {
+                weights(i, j) = infinity;
+            } else if (random() % 2 == 0) {
+                weights(i, j) = Minimum ? half + small : half - small;
+            } else {
+                weights(i, j) = Minimum ? small : -small;
+            }
+        }
+    }
+    const Matrix2D<T> product = weights.multiply(weights, semiring);
+    bool same = true;
+    for (size_t i = 0; i < n; i++) {
+        for (size_t j = 0; j < n; j++) {
+            T best = infinity;
+            for (size_t k = 0; k < n; k++) {
+                const T sum = clampedSum(weights(i, k), weights(k, j), infinity);
+                best = Minimum ? std::min(best, sum) : std::max(best, sum);
+            }
+            same &= product(i, j) == best;
+        }
+    }
+    CHECK(same);
+}
+
+// a chain 0 -> 1 -> ... whose every edge is just over a third of max():
+// two edges are finite, three overflow and must read as unreachable
+template<typename T>
+void testOverflowToInfinity(const size_t n) {
+    const MinPlusSemiring<T> semiring;
+    const T infinity = semiring.zero();
+    Matrix2D<T> weights(n, n);
+    for (size_t i = 0; i < n; i++) {
+        for (size_t j = 0; j < n; j++) {
+            weights(i, j) = j == i + 1 ? infinity / 3 + 1 : infinity;
+        }
+    }
+    const Matrix2D<T> twice = weights.pow(2, semiring);
+    const Matrix2D<T> thrice = weights.pow(3, semiring);
+    CHECK(twice(0, 2) == 2 * (infinity / 3 + 1));
+    bool unreachable = true;
+    for (size_t i = 0; i < n; i++) {
+        for (size_t j = 0; j < n; j++) {
+            unreachable &= thrice(i, j) == infinity;
+        }
+    }
+    CHECK(unreachable);
+}
+
+// values anywhere in uint32_t against products reduced one by one
+void testModular(const uint32_t modulus, const size_t n) {
+    const ModularSemiring semiring(modulus);
+    std::mt19937 random(modulus);
+    Matrix2D<uint32_t> a(n, n);
+    Matrix2D<uint32_t> b(n, n);
+    for (size_t i = 0; i < n; i++) {
+        for (size_t j = 0; j < n; j++) {
+            a(i, j) = random();
+            b(i, j) = random();
+        }
+    }
+    const Matrix2D<uint32_t> product = a.multiply(b, semiring);
+    bool same = true;
+    for (size_t i = 0; i < n; i++) {
+        for (size_t j = 0; j < n; j++) {
+            uint64_t expected = 0;
+            for (size_t k = 0; k < n; k++) {
+                expected = (expected + uint64_t(a(i, k) % modulus) * (b(k, j) % modulus)) % modulus;
+            }
+            same &= product(i, j) == expected;
+        }
+    }
+    CHECK(same);
+    const Matrix2D<uint32_t> cube = a.pow(3, semiring);
+    const Matrix2D<uint32_t> expected = a.multiply(a, semiring).multiply(a, semiring);
+    CHECK(std::equal(cube.data(), cube.data() + n * n, expected.data()));
+    const Matrix2D<uint32_t> first = a.pow(1, semiring);
+    bool reduced = true;
+    for (size_t i = 0; i < n; i++) {
+        for (size_t j = 0; j < n; j++) {
+            reduced &= first(i, j) == a(i, j) % modulus;
+        }
+    }
+    CHECK(reduced);
+}
+
+int main() {
+    for (size_t n : {3, 17, 70}) {
+        testTropical<int64_t, MinPlusSemiring<int64_t>, true>(n);
+        testTropical<int32_t, MinPlusSemiring<int32_t>, true>(n);
+        testTropical<int64_t, MaxPlusSemiring<int64_t>, false>(n);
+        testTropical<int32_t, MaxPlusSemiring<int32_t>, false>(n);
+        testOverflowToInfinity<int64_t>(n);
+        testOverflowToInfinity<int32_t>(n);
+        testOverflowToInfinity<uint32_t>(n);
+    }
+    for (uint32_t modulus : {2u, 7u, 1'000'000'007u, 4'294'967'291u}) {
+        for (size_t n : {1, 5, 40}) {
+            testModular(modulus, n);
+        }
+    }
+    return testResult("SemiringTest");
+}
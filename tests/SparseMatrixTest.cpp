@@ -0,0 +1,151 @@
+#include <random>
+#include <vector>
+#include <cstdint>
+#include <stdexcept>
+#include "Test.h"
+#include "ThreadPool.h"
+#include "SparseMatrix.h"
+
+// SparseMatrix in both formats against a dense Matrix2D holding the same
+// elements: SpMV and SpMM on sizes below and above the parallel threshold,
+// conversions, element access, and powMultiply on both of its paths against
+// repeated dense products. Integer elements keep every comparison exact
+using Sparse = SparseMatrix<int64_t>;
+
+std::vector<Sparse::Triplet> randomTriplets(size_t rows, size_t columns, size_t count, std::mt19937& random) {
+    std::vector<Sparse::Triplet> triplets;
+    for (size_t i = 0; i < count; i++) {
+        triplets.push_back({random() % rows, random() % columns, static_cast<int64_t>(random() % 21) - 10});
+    }
+    return triplets;
+}
+
+Matrix2D<int64_t> denseOf(size_t rows, size_t columns, const std::vector<Sparse::Triplet>& triplets) {
+    Matrix2D<int64_t> dense(rows, columns);
+    for (const Sparse::Triplet& triplet : triplets) {
+        dense(triplet.row, triplet.column) += triplet.value;
+    }
+    return dense;
+}
+
+template<typename T>
+std::vector<T> multiply(const Matrix2D<T>& dense, const std::vector<T>& vector) {
+    const auto size = dense.size();
+    std::vector<T> result(size.first, T(0));
+    for (size_t row = 0; row < size.first; row++) {
+        for (size_t column = 0; column < size.second; column++) {
+            result[row] += dense(row, column) * vector[column];
+        }
+    }
+    return result;
+}
+
+template<typename T>
+bool sameMatrix(const Matrix2D<T>& first, const Matrix2D<T>& second) {
+    const auto size = first.size();
+    return size == second.size() &&
+           std::equal(first.data(), first.data() + size.first * size.second, second.data());
+}
+
+void testProducts(size_t rows, size_t columns, size_t count, size_t width, uint32_t seed) {
+    std::mt19937 random(seed);
+    const std::vector<Sparse::Triplet> triplets = randomTriplets(rows, columns, count, random);
+    const Matrix2D<int64_t> dense = denseOf(rows, columns, triplets);
+    std::vector<int64_t> vector(columns);
+    for (int64_t& value : vector) {
+        value = static_cast<int64_t>(random() % 2001) - 1000;
+    }
+    Matrix2D<int64_t> operand(columns, width);
+    for (size_t i = 0; i < columns; i++) {
+        for (size_t j = 0; j < width; j++) {
+            operand(i, j) = static_cast<int64_t>(random() % 2001) - 1000;
+        }
+    }
+    const std::vector<int64_t> expectedVector = multiply(dense, vector);
+    const Matrix2D<int64_t> expectedMatrix = dense * operand;
+    for (Sparse::Format format : {Sparse::CSR, Sparse::CSC}) {
+        const Sparse sparse = Sparse::fromTriplets(rows, columns, triplets, format);
+        CHECK(sparse.format() == format);
+        CHECK(sameMatrix(sparse.toDense(), dense));
+        CHECK(sparse * vector == expectedVector);
+        CHECK(sameMatrix(sparse * operand, expectedMatrix));
+        const Sparse other = sparse.toFormat(format == Sparse::CSR ? Sparse::CSC : Sparse::CSR);
+        CHECK(other.nonZeros() == sparse.nonZeros());
+        CHECK(sameMatrix(other.toDense(), dense));
+        CHECK(sameMatrix(Sparse(dense, format).toDense(), dense));
+        bool same = true;
+        for (size_t i = 0; i < 200; i++) {
+            const size_t row = random() % rows;
+            const size_t column = random() % columns;
+            same &= sparse.at(row, column) == dense(row, column);
+        }
+        CHECK(same);
+    }
+}
+
+// duplicates are summed and the ones that cancel are not stored
+void testTriplets() {
+    const Sparse sparse = Sparse::fromTriplets(2, 3, {{0, 1, 4}, {1, 2, 5}, {0, 1, -1}, {1, 0, 2}, {1, 0, -2}});
+    CHECK(sparse.nonZeros() == 2);
+    CHECK(sparse.at(0, 1) == 3 && sparse.at(1, 2) == 5 && sparse.at(1, 0) == 0);
+    CHECK(sparse * std::vector<int64_t>({1, 1, 1}) == std::vector<int64_t>({3, 5}));
+    CHECK(Sparse(2, 3) * std::vector<int64_t>({1, 2, 3}) == std::vector<int64_t>({0, 0}));
+    CHECK(Sparse(2, 3, Sparse::CSC) * std::vector<int64_t>({1, 2, 3}) == std::vector<int64_t>({0, 0}));
+}
+
+// unsigned elements wrap around the same way in both paths, so long runs
+// stay exact
+void testPowMultiply(size_t side, size_t count, size_t n, uint32_t seed) {
+    using Unsigned = SparseMatrix<uint64_t>;
+    std::mt19937 random(seed);
+    std::vector<Unsigned::Triplet> triplets;
+    Matrix2D<uint64_t> dense(side, side);
+    for (size_t i = 0; i < count; i++) {
+        const Unsigned::Triplet triplet = {random() % side, random() % side, random() % 7 + 1};
+        triplets.push_back(triplet);
+        dense(triplet.row, triplet.column) += triplet.value;
+    }
+    std::vector<uint64_t> initial(side);
+    for (uint64_t& value : initial) {
+        value = random() % 100;
+    }
+    std::vector<uint64_t> expected = initial;
+    for (size_t step = 0; step < n; step++) {
+        expected = multiply(dense, expected);
+    }
+    for (Unsigned::Format format : {Unsigned::CSR, Unsigned::CSC}) {
+        const Unsigned sparse = Unsigned::fromTriplets(side, side, triplets, format);
+        CHECK(sparse.powMultiply(n, initial) == expected);
+        CHECK(sparse.powMultiply(0, initial) == initial);
+    }
+}
+
+void testErrors() {
+    const Sparse sparse = Sparse::fromTriplets(2, 3, {{0, 1, 4}});
+    CHECK(throws<std::logic_error>([&]() { sparse * std::vector<int64_t>(2); }));
+    CHECK(throws<std::logic_error>([&]() { sparse * Matrix2D<int64_t>(2, 2); }));
+    CHECK(throws<std::logic_error>([&]() { sparse.powMultiply(1, std::vector<int64_t>(3)); }));
+    CHECK(throws<std::out_of_range>([&]() { sparse.at(2, 0); }));
+    CHECK(throws<std::out_of_range>([&]() { Sparse::fromTriplets(2, 3, {{0, 3, 1}}); }));
+    CHECK(throws<std::length_error>([]() { Sparse(1, size_t(1) << 33); }));
+    CHECK(throws<std::length_error>([]() { Sparse(size_t(1) << 33, 1, Sparse::CSC); }));
+}
+
+int main() {
+    for (size_t threads : {1, 4}) {
+        ThreadPool::shared().resize(threads);
+        testProducts(7, 5, 12, 3, 1);
+        testProducts(1, 40, 30, 2, 2);
+        testProducts(600, 400, 90000, 8, 3);
+        testProducts(3000, 20, 80000, 4, 4);
+    }
+    testTriplets();
+    // 1000 steps of an 8 x 8 matrix square a dense copy, 20 steps of a
+    // sparse 60 x 60 one multiply the vector
+    testPowMultiply(8, 30, 1000, 1);
+    testPowMultiply(8, 30, 1023, 2);
+    testPowMultiply(60, 200, 20, 3);
+    testPowMultiply(1, 1, 5, 4);
+    testErrors();
+    return testResult("SparseMatrixTest");
+}
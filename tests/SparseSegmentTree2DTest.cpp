@@ -0,0 +1,121 @@
+#include <map>
+#include <random>
+#include <vector>
+#include <cstdint>
+#include <stdexcept>
+#include "Test.h"
+#include "SegmentTree2D.h"
+#include "SparseSegmentTree2D.h"
+#include "CompressedSegmentTree2D.h"
+
+// SparseSegmentTree2D and CompressedSegmentTree2D against the dense
+// SegmentTree2D on small grids: random updates of a fixed set of points and
+// random rectangles, empty ones included. On a huge grid, where no dense tree
+// fits, the two are checked against a sum over the points
+struct Rectangle {
+    size_t fromColumn;
+    size_t toColumn;
+    size_t fromRow;
+    size_t toRow;
+};
+
+// mostly proper rectangles, one in eight inverted along some axis
+Rectangle randomRectangle(size_t columns, size_t rows, std::mt19937& random) {
+    Rectangle rectangle = {random() % columns, random() % columns, random() % rows, random() % rows};
+    if (rectangle.fromColumn > rectangle.toColumn && random() % 4 != 0) {
+        std::swap(rectangle.fromColumn, rectangle.toColumn);
+    }
+    if (rectangle.fromRow > rectangle.toRow && random() % 4 != 0) {
+        std::swap(rectangle.fromRow, rectangle.toRow);
+    }
+    return rectangle;
+}
+
+template<typename T, typename Op>
+void testAgainstDense(size_t columns, size_t rows, size_t pointsCount, size_t steps, uint32_t seed) {
+    using Compressed = CompressedSegmentTree2D<T, Op>;
+    std::mt19937 random(seed);
+    const Op op;
+    std::vector<typename Compressed::Point> points;
+    for (size_t i = 0; i < pointsCount; i++) {
+        points.push_back({random() % columns, random() % rows, static_cast<T>(random() % 1000)});
+    }
+    std::vector<std::vector<T>> matrix(columns, std::vector<T>(rows, op.identity()));
+    SparseSegmentTree2D<T, Op> sparse(columns, rows);
+    for (const auto& point : points) {
+        matrix[point.column][point.row] = point.value;
+        sparse.update(point.column, point.row, point.value);
+    }
+    SegmentTree2D<T, Op> dense(matrix);
+    Compressed compressed(columns, rows, points);
+    bool same = true;
+    for (size_t step = 0; step < steps; step++) {
+        if (random() % 2) {
+            const auto& point = points[random() % points.size()];
+            const T value = static_cast<T>(random() % 1000);
+            dense.update(point.column, point.row, value);
+            sparse.update(point.column, point.row, value);
+            compressed.update(point.column, point.row, value);
+        } else {
+            const Rectangle r = randomRectangle(columns, rows, random);
+            const T expected = dense.query(r.fromColumn, r.toColumn, r.fromRow, r.toRow);
+            same &= sparse.query(r.fromColumn, r.toColumn, r.fromRow, r.toRow) == expected;
+            same &= compressed.query(r.fromColumn, r.toColumn, r.fromRow, r.toRow) == expected;
+        }
+    }
+    CHECK(same);
+    CHECK(sparse.query(0, columns - 1, 0, rows - 1) == dense.query(0, columns - 1, 0, rows - 1));
+    CHECK(sparse.query(1, 0, 0, rows - 1) == op.identity());
+    CHECK(compressed.query(0, columns - 1, 1, 0) == op.identity());
+    CHECK(throws<std::out_of_range>([&]() { sparse.query(0, columns, 0, 0); }));
+    CHECK(throws<std::out_of_range>([&]() { sparse.query(1, 0, 0, rows); }));
+    CHECK(throws<std::out_of_range>([&]() { compressed.query(1, 0, 0, rows); }));
+}
+
+void testHugeGrid(size_t pointsCount, size_t queries) {
+    using Tree = CompressedSegmentTree2D<int64_t, SumMonoid<int64_t>>;
+    const size_t side = 1'000'000'000;
+    std::mt19937_64 random(pointsCount);
+    std::vector<Tree::Point> points;
+    std::map<std::pair<size_t, size_t>, int64_t> cells;
+    SparseSegmentTree2D<int64_t, SumMonoid<int64_t>> sparse(side, side);
+    for (size_t i = 0; i < pointsCount; i++) {
+        const Tree::Point point = {random() % side, random() % side, static_cast<int64_t>(random() % 1000)};
+        points.push_back(point);
+        cells[{point.column, point.row}] = point.value;
+        sparse.update(point.column, point.row, point.value);
+    }
+    const Tree compressed(side, side, points);
+    bool same = true;
+    for (size_t i = 0; i < queries; i++) {
+        size_t fromColumn = random() % side;
+        size_t toColumn = random() % side;
+        size_t fromRow = random() % side;
+        size_t toRow = random() % side;
+        if (fromColumn > toColumn) {
+            std::swap(fromColumn, toColumn);
+        }
+        if (fromRow > toRow) {
+            std::swap(fromRow, toRow);
+        }
+        int64_t expected = 0;
+        for (const auto& cell : cells) {
+            if (fromColumn <= cell.first.first && cell.first.first <= toColumn &&
+                fromRow <= cell.first.second && cell.first.second <= toRow) {
+                expected += cell.second;
+            }
+        }
+        same &= sparse.query(fromColumn, toColumn, fromRow, toRow) == expected;
+        same &= compressed.query(fromColumn, toColumn, fromRow, toRow) == expected;
+    }
+    CHECK(same);
+}
+
+int main() {
+    testAgainstDense<int64_t, SumMonoid<int64_t>>(37, 53, 200, 4000, 1);
+    testAgainstDense<int64_t, SumMonoid<int64_t>>(64, 1, 30, 1000, 2);
+    testAgainstDense<int, MaxMonoid<int>>(50, 70, 300, 4000, 3);
+    testAgainstDense<int, MinMonoid<int>>(9, 128, 40, 2000, 4);
+    testHugeGrid(2000, 300);
+    return testResult("SparseSegmentTree2DTest");
+}
@@ -0,0 +1,48 @@
+#include <random>
+#include <vector>
+#include <cstdint>
+#include <stdexcept>
+#include "Test.h"
+#include "ThreadPool.h"
+#include "SegmentTree2D.h"
+#include "StaticSegmentTree2D.h"
+
+// StaticSegmentTree2D, sparse table and prefix table, against the dense
+// SegmentTree2D: random rectangles with empty ones among them, on tables
+// built by one and by several pool threads
+template<typename T, typename Op>
+void testAgainstDense(size_t columns, size_t rows, size_t queries, uint32_t seed) {
+    std::mt19937 random(seed);
+    std::vector<std::vector<T>> matrix(columns, std::vector<T>(rows));
+    for (auto& line : matrix) {
+        for (T& value : line) {
+            value = static_cast<T>(random() % 100000);
+        }
+    }
+    const SegmentTree2D<T, Op> dense(matrix);
+    const StaticSegmentTree2D<T, Op> table(matrix);
+    bool same = true;
+    for (size_t i = 0; i < queries; i++) {
+        const size_t fromColumn = random() % columns;
+        const size_t toColumn = random() % columns;
+        const size_t fromRow = random() % rows;
+        const size_t toRow = random() % rows;
+        same &= table.query(fromColumn, toColumn, fromRow, toRow) ==
+                dense.query(fromColumn, toColumn, fromRow, toRow);
+    }
+    CHECK(same);
+    CHECK(table.query(0, columns - 1, 1, 0) == Op().identity());
+    CHECK(throws<std::out_of_range>([&]() { table.query(0, columns, 0, 0); }));
+    CHECK(throws<std::out_of_range>([&]() { table.query(1, 0, 0, rows); }));
+}
+
+int main() {
+    for (size_t threads : {1, 4}) {
+        ThreadPool::shared().resize(threads);
+        testAgainstDense<int, MinMonoid<int>>(37, 53, 3000, 1);
+        testAgainstDense<int64_t, MaxMonoid<int64_t>>(1, 100, 500, 2);
+        testAgainstDense<int64_t, SumMonoid<int64_t>>(300, 300, 3000, 3);
+        testAgainstDense<uint32_t, XorMonoid<uint32_t>>(64, 7, 1000, 4);
+    }
+    return testResult("StaticSegmentTree2DTest");
+}
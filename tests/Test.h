@@ -0,0 +1,44 @@
+#pragma once
+#include <cstdio>
+
+/* Helpers shared by the test programs in this directory.
+   Every program is one translation unit built from the repository root,
+   and exits with a non-zero status when a check fails:
+
+   g++ -std=c++17 -O2 -pthread -I. tests/<Name>.cpp -o test && ./test
+ */
+
+inline int& failedChecks() {
+    static int failed = 0;
+    return failed;
+}
+
+// reports a failed condition with its source line and keeps going
+#define CHECK(condition)                                                        \
+    do {                                                                        \
+        if (!(condition)) {                                                     \
+            std::printf("%s:%d: check failed: %s\n", __FILE__, __LINE__, #condition); \
+            ++failedChecks();                                                   \
+        }                                                                       \
+    } while (false)
+
+// true when 'function' throws an 'Exception'
+template<typename Exception, typename Function>
+bool throws(Function function) {
+    try {
+        function();
+    } catch (const Exception&) {
+        return true;
+    }
+    return false;
+}
+
+// the exit status of main: prints a summary line
+inline int testResult(const char* name) {
+    if (failedChecks() == 0) {
+        std::printf("%s: ok\n", name);
+        return 0;
+    }
+    std::printf("%s: %d checks failed\n", name, failedChecks());
+    return 1;
+}
@@ -0,0 +1,207 @@
+#include <set>
+#include <random>
+#include <vector>
+#include <cstdint>
+#include <algorithm>
+#include <iterator>
+#include <stdexcept>
+#include "Test.h"
+#include "ThreadPool.h"
+#include "Treap.h"
+
+// Treap against a sorted std::vector: random inserts and erases with
+// duplicates, and the order statistics after each; the set operations
+// against std::set_union and friends, on sizes below and above the parallel
+// grain, and the slab staying bounded when they repeat
+
+// std::allocator that keeps the largest number of bytes it ever held at once
+template<typename T>
+struct CountingAllocator {
+    using value_type = T;
+
+    static size_t& held() {
+        static size_t bytes = 0;
+        return bytes;
+    }
+
+    static size_t& peak() {
+        static size_t bytes = 0;
+        return bytes;
+    }
+
+    CountingAllocator() { }
+
+    template<typename U>
+    CountingAllocator(const CountingAllocator<U>&) { }
+
+    T* allocate(size_t count) {
+        held() += count * sizeof(T);
+        peak() = std::max(peak(), held());
+        return std::allocator<T>().allocate(count);
+    }
+
+    void deallocate(T* pointer, size_t count) {
+        held() -= count * sizeof(T);
+        std::allocator<T>().deallocate(pointer, count);
+    }
+
+    template<typename U>
+    bool operator==(const CountingAllocator<U>&) const {
+        return true;
+    }
+
+    template<typename U>
+    bool operator!=(const CountingAllocator<U>&) const {
+        return false;
+    }
+};
+
+using IntTreap = Treap<int, std::allocator<int>, std::less<int>>;
+
+std::set<int> randomSet(size_t count, int range, std::mt19937& random) {
+    std::set<int> set;
+    while (set.size() < count) {
+        set.insert(static_cast<int>(random() % range));
+    }
+    return set;
+}
+
+template<typename Set>
+Set makeTreap(const std::set<int>& values) {
+    Set treap;
+    for (int value : values) {
+        treap.insert(value);
+    }
+    return treap;
+}
+
+// insert, erase of every equal element, and all queries, on a small key
+// range so that duplicates are common
+void testOrderStatistics(size_t steps, int range, uint32_t seed) {
+    std::mt19937 random(seed);
+    IntTreap treap;
+    std::vector<int> sorted;
+    bool same = true;
+    for (size_t step = 0; step < steps; step++) {
+        const int value = static_cast<int>(random() % range);
+        if (random() % 3 != 0) {
+            treap.insert(value);
+            sorted.insert(std::upper_bound(sorted.begin(), sorted.end(), value), value);
+        } else {
+            treap.erase(value);
+            const auto equal = std::equal_range(sorted.begin(), sorted.end(), value);
+            sorted.erase(equal.first, equal.second);
+        }
+        const int probe = static_cast<int>(random() % (range + 2)) - 1;
+        const int to = probe + static_cast<int>(random() % (range / 4 + 1)) - 1;
+        const auto lower = std::lower_bound(sorted.begin(), sorted.end(), probe);
+        const auto upper = std::upper_bound(sorted.begin(), sorted.end(), probe);
+        same &= treap.size() == sorted.size();
+        same &= treap.rank(probe) == static_cast<size_t>(lower - sorted.begin());
+        same &= treap.contains(probe) == (lower != upper);
+        same &= lower == sorted.end() ? treap.lowerBound(probe) == nullptr : *treap.lowerBound(probe) == *lower;
+        same &= upper == sorted.end() ? treap.upperBound(probe) == nullptr : *treap.upperBound(probe) == *upper;
+        const size_t inRange = to < probe ? 0 :
+                std::upper_bound(sorted.begin(), sorted.end(), to) - lower;
+        same &= treap.countInRange(probe, to) == inRange;
+        if (!sorted.empty()) {
+            const size_t k = random() % sorted.size();
+            same &= treap.kth(k) == sorted[k];
+        }
+    }
+    CHECK(same);
+    CHECK(treap.toVector() == sorted);
+    CHECK(throws<std::out_of_range>([&]() { treap.kth(sorted.size()); }));
+    const IntTreap built = IntTreap::fromSorted(sorted.begin(), sorted.end());
+    CHECK(built.toVector() == sorted);
+    CHECK(sorted.empty() || built.kth(sorted.size() / 2) == sorted[sorted.size() / 2]);
+}
+
+void testSetOperations(size_t firstCount, size_t secondCount, int range, uint32_t seed) {
+    std::mt19937 random(seed);
+    const std::set<int> first = randomSet(firstCount, range, random);
+    const std::set<int> second = randomSet(secondCount, range, random);
+    const IntTreap other = makeTreap<IntTreap>(second);
+    std::vector<int> expected;
+
+    IntTreap treap = makeTreap<IntTreap>(first);
+    treap.unionWith(other);
+    std::set_union(first.begin(), first.end(), second.begin(), second.end(), std::back_inserter(expected));
+    CHECK(treap.toVector() == expected);
+    CHECK(treap.size() == expected.size());
+
+    expected.clear();
+    treap = makeTreap<IntTreap>(first);
+    treap.intersectWith(other);
+    std::set_intersection(first.begin(), first.end(), second.begin(), second.end(), std::back_inserter(expected));
+    CHECK(treap.toVector() == expected);
+
+    expected.clear();
+    treap = makeTreap<IntTreap>(first);
+    treap.differenceWith(other);
+    std::set_difference(first.begin(), first.end(), second.begin(), second.end(), std::back_inserter(expected));
+    CHECK(treap.toVector() == expected);
+    // the treap keeps working on the slots the operation freed
+    treap.insert(-1);
+    treap.unionWith(other);
+    std::set<int> united(second);
+    united.insert(expected.begin(), expected.end());
+    united.insert(-1);
+    CHECK(treap.toVector() == std::vector<int>(united.begin(), united.end()));
+    CHECK(treap.contains(-1) && treap.kth(0) == -1);
+}
+
+// the same union and intersection over and over: the nodes each one drops
+// are reused by the next import, so the slab does not keep growing
+void testRepeatedOperations(size_t count) {
+    using CountingTreap = Treap<int, CountingAllocator<int>, std::less<int>>;
+    std::mt19937 random(static_cast<uint32_t>(count));
+    const std::set<int> values = randomSet(count, static_cast<int>(count * 4), random);
+    const CountingTreap other = makeTreap<CountingTreap>(values);
+    CountingTreap treap = makeTreap<CountingTreap>(values);
+    treap.unionWith(other);
+    const size_t peak = CountingAllocator<int>::peak();
+    for (int round = 0; round < 20; round++) {
+        treap.unionWith(other);
+        treap.intersectWith(other);
+    }
+    CHECK(treap.size() == values.size());
+    CHECK(CountingAllocator<int>::peak() == peak);
+    treap.compact();
+    CHECK(treap.toVector() == std::vector<int>(values.begin(), values.end()));
+    treap.insert(-1);
+    CHECK(treap.size() == values.size() + 1 && treap.kth(0) == -1);
+}
+
+void testEmpty() {
+    IntTreap treap;
+    IntTreap other = makeTreap<IntTreap>({1, 2, 3});
+    treap.intersectWith(other);
+    CHECK(treap.size() == 0);
+    treap.unionWith(other);
+    treap.differenceWith(IntTreap());
+    CHECK(treap.toVector() == std::vector<int>({1, 2, 3}));
+    treap.differenceWith(other);
+    CHECK(treap.size() == 0);
+    treap.compact();
+    treap.insert(5);
+    CHECK(treap.toVector() == std::vector<int>({5}));
+}
+
+int main() {
+    testOrderStatistics(2000, 50, 1);
+    testOrderStatistics(20000, 5000, 2);
+    const std::vector<int> unsorted = {1, 3, 2};
+    CHECK(throws<std::invalid_argument>([&]() { IntTreap::fromSorted(unsorted.begin(), unsorted.end()); }));
+    for (size_t threads : {1, 4}) {
+        ThreadPool::shared().resize(threads);
+        testSetOperations(100, 80, 300, 1);
+        testSetOperations(1000, 10, 5000, 2);
+        testSetOperations(1 << 16, 1 << 16, 1 << 18, 3);
+        testSetOperations(1 << 17, 1 << 12, 1 << 18, 4);
+    }
+    testRepeatedOperations(1000);
+    testRepeatedOperations(1 << 16);
+    testEmpty();
+    return testResult("TreapTest");
+}